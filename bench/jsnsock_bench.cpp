@@ -0,0 +1,426 @@
+/**
+ * jsnSock loopback benchmarks
+ *
+ * Measures the library's hot paths over 127.0.0.1 at a chosen concurrency:
+ *
+ *	accept		connections accepted per second by a reactor-mode server
+ *	echo		round-trip latency percentiles through a stream-mode server
+ *	bulk		send/recv throughput, one stream per connection
+ *	readline	lines per second through JSNSockTCP::readline
+ *	lines		the same stream split in batches by JSNSockDelimitedChannel
+ *	timed		the echo benchmark untimed, then with a socket timeout
+ *
+ * Each result is printed on stdout as one JSON object per line, so runs
+ * can be stored and compared; diagnostics go to stderr.
+ *
+ * (C) 2012 Jason Browning
+ */
+
+#include <inttypes.h>	/* strtoimax() */
+#include <sys/socket.h>
+#include <netinet/tcp.h>	/* TCP_NODELAY */
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <JSNSock.hpp>
+#include <JSNSockDelimited.hpp>
+
+using namespace std;
+using namespace jsnSock;
+
+typedef chrono::steady_clock	benchClock;
+
+struct settings
+{
+    uint32_t	concurrency	= 4;		/* client connections (one thread each) */
+    uint32_t	iterations	= 5000;		/* round trips or connections per client */
+    size_t	messageSize	= 64;		/* echo payload and readline line length */
+    size_t	bulkBytes	= 32 << 20;	/* bytes per connection in 'bulk' */
+    uint32_t	lines		= 200000;	/* lines per connection in 'readline' */
+    double	timeout		= 5.0;		/* socket timeout for the timed run */
+    uint16_t	port		= 47100;	/* first port; each benchmark takes the next */
+};
+
+/* One JSON line: fields are appended in order */
+class record
+{
+    private:
+	ostringstream	out;
+	bool		first = true;
+
+    public:
+	record (const string &bench, const settings &config)
+	{
+	    out << fixed << setprecision(3) << '{';
+	    field("bench", bench);
+	    field("concurrency", config.concurrency);
+	}
+
+	auto field (const string &name, const string &value)		-> record &
+	{
+	    out << (first ? "" : ",") << '"' << name << "\":\"" << value << '"';
+	    first = false;
+	    return *this;
+	}
+
+	template <typename T>
+	auto field (const string &name, T value)			-> record &
+	{
+	    out << (first ? "" : ",") << '"' << name << "\":" << value;
+	    first = false;
+	    return *this;
+	}
+
+	auto latency (const JSNSockHistogram &h)			-> record &
+	{
+	    return field("p50_ns", h.percentile(0.5)).field("p90_ns", h.percentile(0.9))
+		    .field("p99_ns", h.percentile(0.99)).field("p999_ns", h.percentile(0.999))
+		    .field("max_ns", h.max()).field("mean_ns", h.mean());
+	}
+
+	~record ()
+	{
+	    cout << out.str() << '}' << endl;
+	}
+};
+
+static auto seconds (benchClock::time_point since)			-> double
+{
+    return chrono::duration<double>(benchClock::now() - since).count();
+}
+
+/* A listening server with its reactor running on a thread of its own */
+class loopbackServer
+{
+    private:
+	JSNSockReactor		reactor;
+	thread			loop;
+
+    public:
+	JSNSockTCPServer	server;
+
+	loopbackServer (uint16_t port)
+	{
+	    int		on = 1;
+
+	    server.setSockOption(SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	    server.bind(port, "127.0.0.1");
+	    server.listen();
+	}
+
+	template <typename Handler>
+	auto start (Handler handler)					-> void
+	{
+	    server.attach(reactor, handler);
+	    loop = thread([this]() { reactor.run(); });
+	}
+
+	~loopbackServer ()
+	{
+	    reactor.stop();
+	    if (loop.joinable())
+		loop.join();
+	}
+};
+
+/* Run 'body(client)' on 'concurrency' threads and wait for all of them */
+template <typename Body>
+static auto clients (const settings &config, Body body)		-> void
+{
+    vector<thread>	threads;
+
+    for (uint32_t c = 0; c < config.concurrency; c++)
+	threads.emplace_back([&body, c]()
+		{
+		    try
+		    {
+			body(c);
+		    }
+		    catch (JSNException &e)
+		    {
+			cerr << "client " << c << ": " << e.what() << endl;
+		    }
+		});
+
+    for (thread &t : threads)
+	t.join();
+}
+
+/* Connections accepted per second; clients reset instead of closing so	*/
+/* no TIME_WAIT state builds up on the loopback ports.			*/
+static auto benchAccept (const settings &config)			-> void
+{
+    loopbackServer		server(config.port);
+    benchClock::time_point	started;
+
+    server.start(JSNSockTCPServer::eventHandler([](JSNSockTCP &socket, uint32_t events)
+		{
+		    socket.close();
+		}));
+
+    started = benchClock::now();
+    clients(config, [&config](uint32_t)
+	    {
+		struct linger	reset = { 1, 0 };
+
+		for (uint32_t i = 0; i < config.iterations; i++)
+		{
+		    JSNSockTCP	socket("127.0.0.1", config.port);
+		    socket.setSockOption(SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+		}
+	    });
+
+    double	elapsed = seconds(started);
+    uint64_t	total = uint64_t(config.iterations) * config.concurrency;
+
+    record("accept", config).field("connections", total).field("seconds", elapsed)
+	.field("per_second", total / elapsed);
+}
+
+/* Round trips of 'messageSize' bytes through a stream-mode server */
+static auto benchEcho (const settings &config, const string &name,
+	double timeout, uint16_t port)					-> void
+{
+    loopbackServer		server(port);
+    JSNSockHistogram		latency;
+    mutex			merge;
+    benchClock::time_point	started;
+    JSNSockTCPServer		&echo = server.server;
+
+    server.start(JSNSockTCPServer::streamHandler([&echo](JSNSockTCP &socket, JSNSockView data)
+		{
+		    if (!data.empty())
+			echo.reply(socket, string(data.data, data.size));
+		}));
+
+    started = benchClock::now();
+    clients(config, [&](uint32_t)
+	    {
+		JSNSockTCP		socket("127.0.0.1", port, timeout);
+		JSNSockHistogram	mine;
+		string			message(config.messageSize, 'e');
+		vector<char>		answer(config.messageSize);
+		int			on = 1;
+
+		socket.setSockOption(IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		for (uint32_t i = 0; i < config.iterations; i++)
+		{
+		    benchClock::time_point	sent = benchClock::now();
+		    size_t			received = 0;
+
+		    socket.send(message);
+		    while (received < answer.size())
+		    {
+			size_t	n = socket.recv(answer.data() + received, answer.size() - received);
+			if (n == 0)
+			    throw JSNException("echo: connection closed early.");
+			received += n;
+		    }
+		    mine.record(chrono::duration_cast<chrono::nanoseconds>(
+				benchClock::now() - sent).count());
+		}
+
+		lock_guard<mutex>	guard(merge);
+		latency += mine;
+	    });
+
+    double	elapsed = seconds(started);
+
+    record(name, config).field("timeout", timeout).field("message_bytes", config.messageSize)
+	.field("round_trips", latency.total).field("seconds", elapsed)
+	.field("per_second", latency.total / elapsed).latency(latency);
+}
+
+/* Each client sends 'bulkBytes'; the server acknowledges the last byte */
+static auto benchBulk (const settings &config)				-> void
+{
+    unordered_map<int, size_t>		received;	/* reactor thread only; outlives it */
+    loopbackServer			server(config.port + 1);
+    benchClock::time_point		started;
+    JSNSockTCPServer			&sink = server.server;
+    size_t				expected = config.bulkBytes;
+
+    server.start(JSNSockTCPServer::streamHandler(
+		[&sink, &received, expected](JSNSockTCP &socket, JSNSockView data)
+		{
+		    size_t	&count = received[socket.descriptor()];
+
+		    if (data.empty())
+			received.erase(socket.descriptor());
+		    else if ( (count += data.size) == expected )
+			sink.reply(socket, "k");
+		}));
+
+    started = benchClock::now();
+    clients(config, [&config](uint32_t)
+	    {
+		JSNSockTCP	socket("127.0.0.1", config.port + 1);
+		vector<char>	chunk(1 << 20, 'b');
+		size_t		sent = 0;
+
+		while (sent < config.bulkBytes)
+		{
+		    size_t	n = min(chunk.size(), config.bulkBytes - sent);
+		    socket.sendAll(chunk.data(), n);
+		    sent += n;
+		}
+		socket.recv(1);	/* the acknowledgement */
+	    });
+
+    double	elapsed = seconds(started);
+    double	total = double(config.bulkBytes) * config.concurrency;
+
+    record("bulk", config).field("bytes", uint64_t(total)).field("seconds", elapsed)
+	.field("mib_per_second", total / elapsed / (1 << 20));
+}
+
+/* Lines through JSNSockTCP::readline or, 'delimited', a JSNSockDelimitedChannel;	*/
+/* one blocking server thread per client.					*/
+static auto benchReadline (const settings &config, bool delimited)	-> void
+{
+    uint16_t			port = delimited ? config.port + 6 : config.port + 2;
+    JSNSockTCPServer		server;
+    int				on = 1;
+    vector<thread>		readers;
+    benchClock::time_point	started;
+
+    server.setSockOption(SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    server.bind(port, "127.0.0.1");
+    server.listen();
+
+    readers.emplace_back([&server, &config, delimited]()
+	    {
+		vector<thread>	sessions;
+
+		for (uint32_t c = 0; c < config.concurrency; c++)
+		    sessions.emplace_back([delimited](JSNSockTCP socket)
+			    {
+				if (delimited)
+				{
+				    JSNSockDelimitedChannel	channel(socket);
+				    vector<JSNSockView>		lines;
+				    bool			ended = false;
+
+				    while (!ended && channel.receive(lines))
+					ended = (lines.back().str() == "end");
+				}
+				else
+				    while (socket.readline() != "end")
+					;
+				socket.send("k");
+			    }, server.accept());
+
+		for (thread &t : sessions)
+		    t.join();
+	    });
+
+    started = benchClock::now();
+    clients(config, [&config, port](uint32_t)
+	    {
+		JSNSockTCP	socket("127.0.0.1", port);
+		string		line(config.messageSize - 1, 'l');
+		string		block;
+		uint32_t	sent = 0;
+
+		line += '\n';
+		while (block.size() < (256 << 10))
+		    block += line;
+
+		for (uint32_t per = block.size() / line.size(); sent < config.lines; sent += per)
+		{
+		    if (config.lines - sent < per)
+			block.resize((config.lines - sent) * line.size());
+		    socket.send(block);
+		}
+		socket.send("end\n");
+		socket.recv(1);	/* the server has read every line */
+	    });
+
+    double	elapsed = seconds(started);
+    uint64_t	total = uint64_t(config.lines) * config.concurrency;
+
+    for (thread &t : readers)
+	t.join();
+
+    record r(delimited ? "lines" : "readline", config);
+
+    if (delimited)
+	r.field("engine", string(JSNSockDelimiter::engine()));
+    r.field("line_bytes", config.messageSize).field("lines", total)
+	.field("seconds", elapsed).field("per_second", total / elapsed);
+}
+
+int main(int argc, const char *argv[])  {
+
+    settings	config;
+    string	which = "all";
+
+    for (int i = 1; i < argc; i++)
+    {
+	string	option = argv[i];
+	bool	valued = (i + 1 < argc);
+
+	if (option == "--concurrency" && valued)
+	    config.concurrency = strtoimax(argv[++i], nullptr, 0);
+	else if (option == "--iterations" && valued)
+	    config.iterations = strtoimax(argv[++i], nullptr, 0);
+	else if (option == "--message" && valued)
+	    config.messageSize = strtoimax(argv[++i], nullptr, 0);
+	else if (option == "--bytes" && valued)
+	    config.bulkBytes = strtoimax(argv[++i], nullptr, 0);
+	else if (option == "--lines" && valued)
+	    config.lines = strtoimax(argv[++i], nullptr, 0);
+	else if (option == "--timeout" && valued)
+	    config.timeout = strtod(argv[++i], nullptr);
+	else if (option == "--port" && valued)
+	    config.port = strtoimax(argv[++i], nullptr, 0);
+	else if (option[0] != '-')
+	    which = option;
+	else
+	{
+	    cerr << "Usage: " << argv[0] << " [accept|echo|bulk|readline|lines|timed|all]"
+		 << " [--concurrency n] [--iterations n] [--message bytes] [--bytes n]"
+		 << " [--lines n] [--timeout seconds] [--port first]" << endl;
+	    return 2;
+	}
+    }
+
+    if (config.concurrency == 0 || config.messageSize < 2)
+    {
+	cerr << argv[0] << ": concurrency and message size must be positive" << endl;
+	return 2;
+    }
+
+    try
+    {
+	bool	all = (which == "all");
+
+	if (all || which == "accept")
+	    benchAccept(config);
+	if (all || which == "echo")
+	    benchEcho(config, "echo", 0.0, config.port + 3);
+	if (all || which == "bulk")
+	    benchBulk(config);
+	if (all || which == "readline")
+	    benchReadline(config, false);
+	if (all || which == "lines")
+	    benchReadline(config, true);
+	if (all || which == "timed")
+	{
+	    benchEcho(config, "timed", 0.0, config.port + 4);
+	    benchEcho(config, "timed", config.timeout, config.port + 5);
+	}
+    }
+    catch (JSNException &e)
+    {
+	cerr << argv[0] << ": " << e.what() << endl;
+	return 1;
+    }
+}
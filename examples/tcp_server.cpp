@@ -32,6 +32,7 @@ int main(int argc, const char *argv[])  {
 
     cout << "Args: " << argv[0] << ", " << argv[1] << endl;
     JSNSockTCPServer ss;
+    JSNSockLog::setLevel(JSNSockLog::info);	/* report binding and listening */
 
     try {
 	ss.bind(strtoimax(argv[1], nullptr, 0));
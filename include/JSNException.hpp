@@ -22,10 +22,11 @@
 
 #ifndef _JSNException_
 #define _JSNException_
-#define		SIZE_ERROR_BUFFER	1024
+#define		SIZE_ERROR_BUFFER	256	/* held in the exception object */
 
 /* Include */
 #include <stdio.h>
+#include <string.h>	/* strerror_r */
 #include <exception>
 #include <cerrno>
 
@@ -35,20 +36,36 @@ using std::exception;
 /* Interface + Implementation */
 namespace jsnSock
 {
+    /* The message is formatted into the exception object itself: there	*/
+    /* is no allocation beyond the runtime's own for the throw, copies	*/
+    /* are safe, and strerror_r keeps the text thread-safe.  'code'	*/
+    /* holds the errno value current at construction.			*/
     class JSNException : public exception
     {
 	private:
-	    char *error_buffer;
+	    int		error_code;
+	    char	error_buffer[SIZE_ERROR_BUFFER];
+
+	    /* strerror_r is the GNU (char *) or the XSI (int) variant */
+	    static auto describe (const char *result, const char *)	-> const char *
+	    { return result; }
+	    static auto describe (int result, const char *scratch)	-> const char *
+	    { return result == 0 ? scratch : "Unknown error"; }
+
 	public:
 	    JSNException( const char *error_msg )
+	    : error_code(errno)
 	    {
-		error_buffer = new char[SIZE_ERROR_BUFFER];
-		snprintf(error_buffer, SIZE_ERROR_BUFFER, "%s : %s [END]", error_msg, strerror(errno));
+		char	scratch[128] = "";
+
+		snprintf(error_buffer, SIZE_ERROR_BUFFER, "%s : %s [END]", error_msg,
+			describe(strerror_r(error_code, scratch, sizeof(scratch)), scratch));
+		errno = error_code;	/* callers may still inspect errno */
 	    }
 
-	    ~JSNException() noexcept
+	    auto code() const noexcept					-> int
 	    {
-		delete [] error_buffer;
+		return error_code;
 	    }
 
 	    const char * what() const noexcept
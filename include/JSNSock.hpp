@@ -29,12 +29,45 @@
 #define JSN_RECVBUF_SIZE 1024
 #define ADDR_STR_LEN 46
 #define JSN_CONNECT_MAX 8
+#define JSN_LISTEN_BACKLOG 4096	/* listen(2) backlog; the kernel clamps it to net.core.somaxconn */
+#define JSN_FASTOPEN_QUEUE 256	/* pending TCP Fast Open requests per listener */
+#define JSN_CONNECT_STAGGER 0.25	/* seconds between racing connect attempts (RFC 8305) */
+#define JSN_ZEROCOPY_THRESHOLD 10240	/* below this MSG_ZEROCOPY costs more than a copy */
+#define JSN_UDP_BATCH 64		/* datagrams per recvmmsg/sendmmsg batch */
+#define JSN_UDP_DATAGRAM 2048		/* bytes per received datagram slot */
+#define JSN_UDP_GSO_SEGMENTS 64		/* kernel limit on segments per UDP_SEGMENT send */
+#define JSN_UDP_GSO_BYTES 65000		/* payload per UDP_SEGMENT send (< 64 KiB less headers) */
+#define JSN_SENDBUF_CAPACITY 16384	/* operator<< output buffer, allocated on first use */
+#define JSN_SEND_THRESHOLD 8192		/* buffered output that is sent without waiting for flush */
 /* Includes */
 #include "jsnSock_Prefix.hpp"
 #include <arpa/inet.h> /* includes <sys/socket.h> and <netinet/in.h> */
+#include <chrono>
+#include <sys/uio.h>	/* struct iovec */
 #include <string>
+#include <system_error>
 #include <signal.h>
+#include <cstdio>	/* snprintf: number formatting without <charconv> */
+#include <cstdlib>	/* strtold */
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#if __cplusplus >= 201703L
+#include <charconv>	/* std::to_chars */
+#endif
 #include "JSNException.hpp"
+#include "JSNSockBuffer.hpp"
+#include "JSNSockLog.hpp"
+#include "JSNSockMetrics.hpp"
+#include "JSNSockReactor.hpp"
+#include "JSNSockResolver.hpp"
+#include "JSNSockRing.hpp"
 
 /* Interface Declaration */
 namespace jsnSock
@@ -42,12 +75,18 @@ namespace jsnSock
     class JSNSockBase
     {
 	protected:
-	    int		sockDesc;
+	    int		sockDesc = invalid;	/* owned: closed by the destructor */
 	    uint32_t	domain;		/* uses <sys/socket.h> */
 	    uint32_t	type;		/* uses <sys/socket.h> */
 	    uint32_t	protocol;	/* uses <netinet/in.h> */
 
-	    double	timeout;	/* applies to each of connect, send, and recv */
+	    double	timeout;	/* applies to each of connect, send, and recv;	*/
+	    				/* a timed socket is kept non-blocking and	*/
+	    				/* waits in poll(2) against a deadline.		*/
+
+	    typedef std::chrono::steady_clock	clock;
+
+	    JSNSockCounterSet	counters;	/* bytes, system calls and stalls on this socket */
 
 
 	    JSNSockBase() = default;	/* Explicit 'default' causes system to generate	*/
@@ -59,7 +98,26 @@ namespace jsnSock
 	    
 	    /* A 2-element array to hold socket address/port information (in a std::pair struct) */
 	    std::pair<std::string, uint16_t>	socketInfoArray[2];
+
+	    /* Absolute deadline for an operation starting now; 'max' if untimed */
+	    auto deadline ()						-> clock::time_point;
+
+	    /* poll(2) until 'events' are ready; throws (ETIMEDOUT) at 'limit'.	*/
+	    /* The time spent is recorded in 'timing' while metrics are on.	*/
+	    auto wait (short events, clock::time_point limit,
+		    JSNSockMetrics::histogram timing = JSNSockMetrics::histograms)	-> void;
+
+	    /* The same without throwing: zero once ready, else the errno	*/
+	    /* value (ETIMEDOUT at 'limit').					*/
+	    auto waitFor (short events, clock::time_point limit,
+		    JSNSockMetrics::histogram timing = JSNSockMetrics::histograms)	-> int;
+	    auto waitFor (int fd, short events, clock::time_point limit,	/* 'fd', not the socket */
+		    JSNSockMetrics::histogram timing = JSNSockMetrics::histograms)	-> int;
 	public:
+	    /* The descriptor of a socket that owns nothing (closed, released	*/
+	    /* or moved from).							*/
+	    static const int	invalid = -1;
+
 	    /* Explicitly typed 'enum' declarations must	*/
 	    /* be explicitly scoped during implementationr.	*/
 
@@ -103,17 +161,40 @@ namespace jsnSock
 			);
 
 	    ~JSNSockBase();
+
+	    /* Sockets are move-only: exactly one object owns a descriptor,	*/
+	    /* so they can live in containers without copies or double-close.	*/
+	    JSNSockBase (const JSNSockBase &)				= delete;
+	    auto operator= (const JSNSockBase &)			-> JSNSockBase & = delete;
+	    JSNSockBase (JSNSockBase &&other) noexcept;
+	    auto operator= (JSNSockBase &&other) noexcept		-> JSNSockBase &;
 	    
 	    /** JSNSockBase Function Declarations **/
 	    auto close () 						-> void;
 
+	    /* The underlying descriptor; 'invalid' once closed */
+	    auto descriptor ()						-> int
+	    { return sockDesc; }
+	    auto valid ()						-> bool
+	    { return sockDesc != invalid; }
+
+	    /* This socket's counters so far (see JSNSockMetrics for totals) */
+	    auto stats () const						-> JSNSockCounters
+	    { return counters.snapshot(); }
+
+	    /* Ownership transfer: 'release' hands the descriptor to the	*/
+	    /* caller (this object no longer closes it); 'adopt' closes the	*/
+	    /* current descriptor and takes ownership of 'fd'.			*/
+	    auto release ()						-> int;
+	    auto adopt (int fd)						-> void;
+
 	    /* Get/Set Socket Options */
 	    auto sockOption(int level, int optname, void *optval, 
 		    				socklen_t *optlen)	-> void;
 	    auto setSockOption(int level, int optname, void *optval,
 		    				socklen_t optlen)	-> void;
 
-	    /* Set the Timeout interval */
+	    /* Set the Timeout interval; a non-zero timeout leaves the socket non-blocking */
 	    auto setTimeout(double timeout = 0.0) 			-> void;
 
 	    /* Socket Information Handlers */
@@ -126,7 +207,7 @@ namespace jsnSock
 	    auto remotePort()						-> uint16_t
 	    { return socketInfoArray[0].second;}
 	    auto localAddr()						-> std::string
-	    { return socketInfoArray[0].first;}
+	    { return socketInfoArray[1].first;}
 	    auto localPort()						-> uint16_t
 	    { return socketInfoArray[1].second;}
 
@@ -134,7 +215,8 @@ namespace jsnSock
 	    auto setBlocking(bool on=true)				-> void;
 	    auto isBlocking()						-> bool;
 
-	    /* Get Host by Name/Address */
+	    /* Get Host by Name/Address; names go through the cached	*/
+	    /* JSNSockResolver, an empty string means 'not found'.	*/
 	    auto getHostByName(const std::string &name)			-> std::string;
 	    auto getHostByAddr(const std::string &addr)			-> std::string;
 
@@ -147,39 +229,261 @@ namespace jsnSock
     /* JSNSockTCP
      * Create a TCP Socket
      */
+    class JSNSockStream;	/* JSNSockAsync.hpp: awaitable I/O on the same buffer */
+    class JSNSockSendQueue;	/* JSNSockSendQueue.hpp */
+
     class JSNSockTCP : public JSNSockBase
     {
+	friend class JSNSockStream;
+	friend class JSNSockTCPServer;	/* sets up accepted sockets without extra fcntl calls */
+	friend class JSNSockSendQueue;	/* counts the writes it makes on the socket's behalf */
+
 	protected:
-	    auto select ()				 		-> void;
+	    JSNSockBuffer	recvBuffer;	/* serves readline, recv and operator>> */
+	    JSNSockBuffer	sendBuffer { JSN_SENDBUF_CAPACITY };	/* collects operator<< */
+	    size_t		sendThreshold = JSN_SEND_THRESHOLD;
+
+	    /* Buffer 'size' bytes of output, sending them together with	*/
+	    /* what is waiting once that reaches the threshold.		*/
+	    auto append (const char *data, size_t size)			-> void;
+	    template <class T>
+		auto appendNumber (T value, std::true_type integral)	-> void;
+	    template <class T>
+		auto appendNumber (T value, std::false_type integral)	-> void;
+
+	    /* Send every buffered byte (they are dropped if that fails);	*/
+	    /* 'flags' as for send(2), e.g. MSG_DONTWAIT when closing.	*/
+	    auto sendBuffered (clock::time_point limit, int &error,
+		    			int flags = 0)			-> void;
+
+	    /* One recv(2), waiting for readability until 'limit'; returns	*/
+	    /* zero at end-of-stream.						*/
+	    auto recvSome (void *buffer, size_t size,
+		    			clock::time_point limit)	-> size_t;
+	    auto refill (clock::time_point limit)			-> size_t;
+
+	    /* One sendmsg(2), waiting for writability until 'limit'; may	*/
+	    /* send less than asked.						*/
+	    auto sendSome (const struct iovec *buffers, int count,
+		    	int flags, clock::time_point limit)		-> size_t;
+
+	    /* connect(2) this socket to one address, waiting until 'limit' */
+	    auto connectTo (const JSNSockAddress &address,
+		    			clock::time_point limit)	-> void;
+
+	    /* The cores of the three above: they throw nothing, leaving	*/
+	    /* zero or the errno value in 'error'.				*/
+	    auto recvSome (void *buffer, size_t size,
+		    	clock::time_point limit, int &error)		-> size_t;
+	    auto sendSome (const struct iovec *buffers, int count,
+		    	int flags, clock::time_point limit, int &error)	-> size_t;
+	    auto connectTo (const JSNSockAddress &address,
+		    	clock::time_point limit, int &error)		-> void;
+
+	    /* 'host' resolved for 'port', address families interleaved */
+	    auto candidates (const std::string &host, uint16_t port)	-> JSNSockResolver::addresses;
+	    auto connected (clock::time_point started)			-> void;
+
+	    /* Happy eyeballs: staggered, racing non-blocking connects to	*/
+	    /* every candidate; the first to complete becomes this socket.	*/
+	    auto connectRace (JSNSockResolver::addresses &candidates,
+		    			clock::time_point limit)	-> void;
+
+	public:
+	    /* Called once a zero-copy buffer may be reused */
+	    typedef std::function<void ()>	completion;
+
+	protected:
+	    /* MSG_ZEROCOPY bookkeeping: each zero-copy sendmsg(2) is numbered	*/
+	    /* by the kernel; a buffer completes with the last of its sends.	*/
+	    bool				zeroCopy		= false;
+	    size_t				zeroCopyThreshold	= JSN_ZEROCOPY_THRESHOLD;
+	    uint32_t				zeroCopyNext		= 0;
+	    /* created by the first numbered send: an empty deque allocates */
+	    std::unique_ptr<std::deque<std::pair<uint32_t, completion>>>	zeroCopyPending;
+
+	    auto zeroCopyWaiting () const				-> bool
+	    { return zeroCopyPending && !zeroCopyPending->empty(); }
 
 	public:
 	    JSNSockTCP();
 	    
-	    JSNSockTCP(int sockDesc, double timeout = 0.0);
+	    JSNSockTCP(int sockDesc, double timeout = 0.0);	/* takes ownership of 'sockDesc' */
 	    JSNSockTCP(const std::string &host, uint16_t port, double timeout = 0.0);
+	    ~JSNSockTCP();	/* sends what operator<< left buffered */
+
+	    JSNSockTCP (JSNSockTCP &&)					= default;
+	    auto operator= (JSNSockTCP &&other)				-> JSNSockTCP &;	/* flushes as 'close' first */
 
 
 
 	    /** Methods **/
+	    /* Connects over IPv6 or IPv4, whichever the name resolves to; with	*/
+	    /* several addresses they are raced (IPv6 first, interleaved).	*/
 	    auto connect (const std::string &host, uint16_t port) 	-> void;
 
-	    /* Sending Data via TCP */
+	    /* Sends what operator<< left buffered, then closes the socket */
+	    auto close ()						-> void;
+
+	    /* Error-code forms of connect, send and recv.  Failure is	*/
+	    /* reported in 'error' (EAGAIN on an untimed non-blocking socket,	*/
+	    /* ETIMEDOUT, ECONNRESET, ...), never thrown.  'send' and 'recv'	*/
+	    /* are for hot paths: no exception and no allocation per call.	*/
+	    /* 'connect' is not: it resolves the name into a list of addresses	*/
+	    /* and may throw and catch internally while racing them.		*/
+	    /* 'send' returns the bytes sent, all of them unless 'error' is	*/
+	    /* set; 'recv' returns what one read gave, zero at end of stream.	*/
+	    auto connect (const std::string &host, uint16_t port,
+		    			std::error_code &error)		-> void;
+	    auto send (const void *buffer, size_t size,
+		    			std::error_code &error)		-> size_t;
+	    auto recv (void *buffer, size_t size,
+		    			std::error_code &error)		-> size_t;
+
+	    /* Sending Data via TCP; every send delivers the whole buffer */
 	    auto send (const std::string &buffer) 			-> void; // text data.
 	    auto send (const void *buffer, uint32_t size) 		-> void; // binary data.
-
-	    /* Receiving Data via TCP */
+	    auto sendAll (const void *buffer, size_t size,
+		    				bool more = false)	-> void;
+
+	    /* Scatter-gather: all 'count' buffers go out in as few sendmsg(2)	*/
+	    /* calls as the kernel allows, without being joined first.		*/
+	    /* 'more' sets MSG_MORE: further data follows, hold the segment.	*/
+	    auto sendv (const struct iovec *buffers, int count,
+		    				bool more = false)	-> void;
+
+	    /* Zero-copy transmission: bytes move from 'fd' to the socket	*/
+	    /* inside the kernel.  Both loop on partial progress and return	*/
+	    /* the number of bytes sent, short only if the source ran dry.	*/
+	    /* 'sendPipe' waits for an empty pipe to fill, within the timeout	*/
+	    /* if one is set, whether the pipe is blocking or not.		*/
+	    auto sendFile (int fd, off_t offset = 0,
+		    			size_t length = 0)		-> size_t; // length 0: to end of file
+	    auto sendPipe (int pipeDesc, size_t length)			-> size_t; // read end of a pipe
+
+	    /* MSG_ZEROCOPY: the kernel transmits straight from 'buffer', which	*/
+	    /* must stay untouched until 'done' runs from 'reapZeroCopy'.	*/
+	    /* Payloads under the threshold are copied and complete at once.	*/
+	    auto setZeroCopy (bool on = true,
+		    	size_t threshold = JSN_ZEROCOPY_THRESHOLD)	-> void;
+	    auto sendZeroCopy (const void *buffer, size_t size,
+		    				completion done)	-> void;
+
+	    /* Drain completion notifications from the error queue (never	*/
+	    /* blocks; the socket polls as EPOLLERR when some are waiting).	*/
+	    /* 'awaitZeroCopy' blocks until every outstanding buffer is free.	*/
+	    auto reapZeroCopy ()					-> size_t;
+	    auto awaitZeroCopy ()					-> void;
+	    auto pendingZeroCopy ()					-> size_t
+	    { return zeroCopyPending ? zeroCopyPending->size() : 0; }
+
+	    /* TCP_CORK: batch everything sent until uncorked into full segments */
+	    auto setCork (bool on = true)				-> void;
+
+	    /* Receiving Data via TCP; the byte-count forms return zero only	*/
+	    /* at end-of-stream and never allocate.				*/
 	    auto recv (uint32_t size = JSN_RECVBUF_SIZE) 		-> std::string;
-	    auto recv (void *buffer, uint32_t size) 			-> void;
+	    auto recv (void *buffer, uint32_t size) 			-> size_t;
+	    auto recv (JSNSockLease &buffer)				-> size_t; // fills up to capacity()
 	    auto readline () -> std::string;
 
-	    /* TCP Send Overloaded Operators */
-	    template<class T>
-		auto operator<< (const T &buffer)			-> void;
-	    auto operator<< (const std::string &buffer) 		-> void;
+	    /* Receive Buffer: refilled with one large recv(2) at a time */
+	    auto setRecvBufferSize (size_t size)			-> void;
+	    auto recvBufferCapacity ()					-> size_t
+	    { return recvBuffer.capacity(); }
+	    auto buffered ()						-> size_t
+	    { return recvBuffer.size(); }
+	    auto fill ()						-> size_t;
+
+	    /* Look at buffered bytes without copying (fills if empty; an	*/
+	    /* empty view means end-of-stream), then 'consume' what was used.	*/
+	    auto peek ()						-> JSNSockView;
+	    auto consume (size_t size)					-> void
+	    { recvBuffer.consume(size); }
+
+	    /* Buffered output: insertions are appended to a per-socket	*/
+	    /* buffer (numbers are formatted without a stream) and sent in	*/
+	    /* one call once JSN_SEND_THRESHOLD bytes wait, on 'flush', and	*/
+	    /* before any other send, any receive that reaches the kernel	*/
+	    /* or close.  If that send fails, the buffered bytes are lost.	*/
+	    auto operator<< (const std::string &text) 			-> JSNSockTCP &
+	    { append(text.data(), text.size()); return *this; }
+	    auto operator<< (const char *text)				-> JSNSockTCP &
+	    { append(text, strlen(text)); return *this; }
+	    auto operator<< (JSNSockView text)				-> JSNSockTCP &
+	    { append(text.data, text.size); return *this; }
+	    auto operator<< (char c)					-> JSNSockTCP &
+	    { append(&c, 1); return *this; }
+	    auto operator<< (signed char c)				-> JSNSockTCP &
+	    { return *this << char(c); }
+	    auto operator<< (unsigned char c)				-> JSNSockTCP &
+	    { return *this << char(c); }
+	    auto operator<< (bool b)					-> JSNSockTCP &
+	    { return *this << (b ? '1' : '0'); }
+
+	    template <class T>
+		auto operator<< (T number)				-> typename
+		    std::enable_if<std::is_arithmetic<T>::value, JSNSockTCP &>::type
+		{ appendNumber(number, std::is_integral<T>()); return *this; }
+
+	    /* Anything else with a std::ostream inserter */
+	    template <class T>
+		auto operator<< (const T &value)			-> typename
+		    std::enable_if<!std::is_arithmetic<T>::value, JSNSockTCP &>::type
+		{ std::ostringstream text; text << value; return *this << text.str(); }
+
+	    auto flush ()						-> void;
+	    auto unsent ()						-> size_t
+	    { return sendBuffer.size(); }
+
+	    /* Resizing sends what is waiting first; the threshold is capped	*/
+	    /* at the capacity (0: send only when full or flushed).		*/
+	    auto setSendBufferSize (size_t size)			-> void;
+	    auto setSendThreshold (size_t size)				-> void;
 
 	    /* TCP Receiver Overloaded Operator */
 	    auto operator>> (std::string &buffer) 			-> void;
     }; /* JSNSockTCP */
+
+    template <class T>
+    auto JSNSockTCP::appendNumber (
+	    T			value,
+	    std::true_type	integral
+	    )			-> void
+    {
+	char	text[24];	/* any 64-bit integer, sign included */
+
+#if __cplusplus >= 201703L
+	append(text, std::to_chars(text, text + sizeof(text), value).ptr - text);
+#else
+	if (std::is_signed<T>::value)
+	    append(text, snprintf(text, sizeof(text), "%lld", static_cast<long long>(value)));
+	else
+	    append(text, snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(value)));
+#endif
+    } /* JSNSockTCP::appendNumber (T, std::true_type) */
+
+    template <class T>
+    auto JSNSockTCP::appendNumber (
+	    T			value,
+	    std::false_type	integral
+	    )			-> void
+    {
+	char	text[64];
+
+#if defined(__cpp_lib_to_chars)
+	append(text, std::to_chars(text, text + sizeof(text), value).ptr - text);
+#else
+	/* shortest of the two precisions that reads back as 'value' */
+	int	size = snprintf(text, sizeof(text), "%.*Lg",
+			std::numeric_limits<T>::digits10, static_cast<long double>(value));
+
+	if (static_cast<T>(strtold(text, nullptr)) != value && value == value)
+	    size = snprintf(text, sizeof(text), "%.*Lg",
+			std::numeric_limits<T>::max_digits10, static_cast<long double>(value));
+	append(text, size);
+#endif
+    } /* JSNSockTCP::appendNumber (T, std::false_type) */
     /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 
@@ -189,18 +493,253 @@ namespace jsnSock
      */
     class JSNSockTCPServer : public JSNSockTCP
     {
+	public:
+	    /* Reactor-mode handler; 'events' is a JSNSockReactor::event mask */
+	    typedef std::function<void (JSNSockTCP &socket, uint32_t events)>	eventHandler;
+
+	    /* Stream-mode handler: each chunk received on a connection, then	*/
+	    /* an empty view once the peer has closed (or the connection failed) */
+	    typedef std::function<void (JSNSockTCP &socket, JSNSockView data)>	streamHandler;
+
+	    enum engine : uint32_t
+	    {
+		epoll,		/* JSNSockReactor: readiness, then recv(2)/send(2) */
+		uring		/* JSNSockRing: submissions and completions */
+	    };
+
 	private:
 	    uint32_t		connection_max;
+	    bool		nonBlocking = false;	/* known to be: no fcntl(2) needed */
+
+	    /* Reactor mode: accepted connections, keyed by descriptor.	*/
+	    /* Map nodes never move, so the reactor may hold their address.	*/
+	    eventHandler				handler;
+	    std::unordered_map<int, JSNSockTCP>	connections;
+
+	    /* Stream mode: replies not yet handed to the kernel.  With a ring,	*/
+	    /* one send per connection is in flight and the rest waits here.	*/
+	    struct pendingOutput
+	    {
+		std::string	queued;
+		bool		inFlight = false;
+	    };
+
+	    streamHandler				stream;
+	    JSNSockRing					*ring = nullptr;
+	    std::unordered_map<int, pendingOutput>	output;
+
+	    auto acceptPending (JSNSockReactor &reactor)		-> void;
+	    auto flush (JSNSockTCP &socket)				-> void;
+	    auto transmit (int fd, std::string data)			-> void;
+	    auto drop (int fd)						-> void;
 	public:
+	    /* SO_REUSEPORT; must be set before 'bind' */
+	    auto setReusePort (bool on = true)				-> void;
+
+	    /* TCP_DEFER_ACCEPT: a connection is only accepted once data has	*/
+	    /* arrived on it (or after 'seconds'); zero turns it off.		*/
+	    auto setDeferAccept (uint32_t seconds)			-> void;
+
+	    /* Server-side TCP Fast Open: up to 'queue' pending requests whose	*/
+	    /* SYN carries data; zero turns it off.  Set before 'listen'.	*/
+	    auto setFastOpen (uint32_t queue = JSN_FASTOPEN_QUEUE)	-> void;
+
+	    /* As JSNSockBase's, and remembered for the batch accept and	*/
+	    /* 'attach', which need the listener non-blocking.		*/
+	    auto setBlocking (bool on = true)				-> void;
+	    auto setTimeout (double timeout)				-> void;
 
 	    auto bind (
 		    	uint16_t port,
 			const std::string &address = "",
-			uint32_t capacity = JSN_CONNECT_MAX
+			uint32_t capacity = JSN_LISTEN_BACKLOG
 			)						-> void;
-	    auto listen ()						-> void;
+	    /* 'backlog' of zero keeps the capacity given to 'bind' */
+	    auto listen (uint32_t backlog = 0)				-> void;
 	    auto accept ()						-> JSNSockTCP;
 	    auto accept ( void (*handler)(JSNSockTCP &socket) )		-> bool;
-    };
+
+	    /* Never throws: an invalid socket, and the reason in 'error'.	*/
+	    /* A timed server waits up to its timeout (then ETIMEDOUT), as	*/
+	    /* the throwing 'accept' does.					*/
+	    auto accept (std::error_code &error)			-> JSNSockTCP;
+
+	    /* Drain the accept queue without blocking: appends up to 'limit'	*/
+	    /* (zero: all) pending connections to 'batch' and returns how many.	*/
+	    /* The listening socket is made non-blocking, and so is each	*/
+	    /* accepted socket, ready for a reactor or a ring.			*/
+	    auto accept (std::vector<JSNSockTCP> &batch, size_t limit = 0)	-> size_t;
+
+	    /* Reactor mode: register this (listening) socket with 'reactor'.	*/
+	    /* Each accepted connection is made non-blocking and registered in	*/
+	    /* turn; 'handler' is called with its readiness events.  A		*/
+	    /* connection is dropped once the handler closes it or after a	*/
+	    /* hangup/error event has been delivered.				*/
+	    auto attach (JSNSockReactor &reactor, eventHandler handler)	-> void;
+
+	    /* Stream mode, on either engine: the same 'streamHandler' runs	*/
+	    /* over a reactor (epoll) or a ring (io_uring, where accepts and	*/
+	    /* receives are multishot and replies are queued as submissions).	*/
+	    /* Answer through 'reply', which never blocks.			*/
+	    auto attach (JSNSockReactor &reactor, streamHandler handler)	-> void;
+	    auto attach (JSNSockRing &ring, streamHandler handler)	-> void;
+	    auto reply (JSNSockTCP &socket, std::string data)		-> void;
+    }; /* JSNSockTCPServer */
+    /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+
+    /* JSNSockTCPShardedServer
+     * One SO_REUSEPORT listening socket and one reactor per worker thread,
+     * each worker pinned to its own core.  The kernel spreads incoming
+     * connections across the listeners, so there is no shared accept point.
+     * The handler is invoked concurrently from every worker thread.
+     */
+    class JSNSockTCPShardedServer
+    {
+	private:
+	    std::vector<std::unique_ptr<JSNSockTCPServer>>	servers;
+	    std::vector<std::unique_ptr<JSNSockReactor>>	reactors;
+	    std::vector<std::unique_ptr<JSNSockRing>>		rings;	/* empty unless 'uring' was chosen */
+	    std::vector<std::thread>				workers;
+
+	    template <typename Loop, typename Handler>
+	    auto run (std::vector<std::unique_ptr<Loop>> &loops,
+		    		const Handler &handler)			-> void;
+
+	public:
+	    /* 'shards' of zero means one per hardware thread.  'preferred'	*/
+	    /* picks the engine for stream-mode 'serve'; 'uring' falls back	*/
+	    /* to 'epoll' when this kernel cannot provide a ring.		*/
+	    JSNSockTCPShardedServer (uint32_t shards = 0,
+		    JSNSockTCPServer::engine preferred = JSNSockTCPServer::epoll);
+	    ~JSNSockTCPShardedServer ();
+
+	    /* Applied to every shard's listening socket */
+	    auto setDeferAccept (uint32_t seconds)			-> void;
+	    auto setFastOpen (uint32_t queue = JSN_FASTOPEN_QUEUE)	-> void;
+
+	    auto bind (
+		    	uint16_t port,
+			const std::string &address = "",
+			uint32_t capacity = JSN_LISTEN_BACKLOG
+			)						-> void;
+	    auto listen (uint32_t backlog = 0)				-> void;
+
+	    /* Run every shard; blocks until 'stop' (or a worker throws) */
+	    auto serve (JSNSockTCPServer::eventHandler handler)		-> void;
+	    auto serve (JSNSockTCPServer::streamHandler handler)	-> void;
+	    auto stop ()						-> void;
+
+	    /* The engine stream-mode 'serve' runs on */
+	    auto backend () const					-> JSNSockTCPServer::engine
+	    { return rings.empty() ? JSNSockTCPServer::epoll : JSNSockTCPServer::uring; }
+
+	    auto size ()						-> uint32_t
+	    { return servers.size(); }
+    }; /* JSNSockTCPShardedServer */
+    /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+
+    /* JSNSockDatagramBatch
+     * Preallocated headers, buffers and addresses for moving many
+     * datagrams per recvmmsg(2)/sendmmsg(2).  Received datagrams live in
+     * the batch's own slots; datagrams queued with 'add' are sent from the
+     * caller's memory, which must stay valid until the batch is sent.
+     */
+    class JSNSockDatagramBatch
+    {
+	private:
+	    std::vector<char>		storage;	/* 'capacity' slots of 'slotSize' */
+	    std::vector<struct mmsghdr>	headers;
+	    std::vector<struct iovec>	iov;
+	    std::vector<JSNSockAddress>	peers;
+	    size_t			slotSize;
+	    uint32_t			count;		/* datagrams held */
+
+	    friend class JSNSockUDP;
+	    auto prepareReceive ()					-> void;
+
+	public:
+	    JSNSockDatagramBatch (uint32_t capacity = JSN_UDP_BATCH,
+		    		  size_t datagramSize = JSN_UDP_DATAGRAM);
+
+	    JSNSockDatagramBatch (const JSNSockDatagramBatch &)		= delete;
+	    auto operator= (const JSNSockDatagramBatch &)		-> JSNSockDatagramBatch & = delete;
+
+	    auto size () const						-> uint32_t
+	    { return count; }
+	    auto capacity () const					-> uint32_t
+	    { return headers.size(); }
+	    auto clear ()						-> void
+	    { count = 0; }
+
+	    /* The i'th datagram, its source (received) or destination	*/
+	    /* (queued), and whether it was cut short to fit its slot.	*/
+	    auto datagram (uint32_t i) const				-> JSNSockView
+	    { return JSNSockView { static_cast<const char *>(iov[i].iov_base), headers[i].msg_len }; }
+	    auto address (uint32_t i) const				-> const JSNSockAddress &
+	    { return peers[i]; }
+	    auto truncated (uint32_t i) const				-> bool
+	    { return headers[i].msg_hdr.msg_flags & MSG_TRUNC; }
+
+	    /* Queue a datagram for sending; 'to' may be null on a connected	*/
+	    /* socket.  Returns false when the batch is full.			*/
+	    auto add (const void *data, size_t size,
+		    		const JSNSockAddress *to = nullptr)	-> bool;
+    }; /* JSNSockDatagramBatch */
+
+
+
+    /* JSNSockUDP
+     * Create a UDP Socket
+     */
+    class JSNSockUDP : public JSNSockBase
+    {
+	public:
+	    JSNSockUDP (uint32_t domain = domain::inet, double timeout = 0.0);
+
+	    JSNSockUDP (JSNSockUDP &&)					= default;
+	    auto operator= (JSNSockUDP &&)				-> JSNSockUDP & = default;
+
+	    /* 'address' empty: every local address of the socket's family */
+	    auto bind (uint16_t port, const std::string &address = "")	-> void;
+
+	    /* Fix the default destination (and filter the sources) */
+	    auto connect (const std::string &host, uint16_t port)	-> void;
+
+	    /* Resolve 'host' to an address of this socket's family */
+	    auto address (const std::string &host, uint16_t port)	-> JSNSockAddress;
+
+	    /* Single datagrams */
+	    auto sendTo (const void *buffer, size_t size,
+		    		const JSNSockAddress *to = nullptr)	-> void;
+	    auto recvFrom (void *buffer, size_t size,
+		    		JSNSockAddress *from = nullptr)		-> size_t;
+
+	    /* Batches: one syscall per batch.  'send' delivers every queued	*/
+	    /* datagram and returns the count; 'recv' waits for the first	*/
+	    /* datagram, then takes whatever else is already queued.		*/
+	    auto send (JSNSockDatagramBatch &batch)			-> uint32_t;
+	    auto recv (JSNSockDatagramBatch &batch)			-> uint32_t;
+
+	    /* Segmentation offload (UDP_SEGMENT): the kernel (or NIC) cuts	*/
+	    /* 'buffer' into datagrams of 'segment' bytes, the last possibly	*/
+	    /* shorter.  Buffers beyond one offload unit are sent in several	*/
+	    /* calls.  Returns the number of datagrams produced.		*/
+	    auto sendSegmented (const void *buffer, size_t size, uint16_t segment,
+		    		const JSNSockAddress *to = nullptr)	-> uint32_t;
+
+	    /* Receive offload (UDP_GRO): a read may return several		*/
+	    /* coalesced datagrams from one source.  'recvSegmented' fills	*/
+	    /* 'segments' with one view per original datagram, all pointing	*/
+	    /* into 'buffer', and returns the total byte count.  'buffer'	*/
+	    /* should hold 64 KiB to avoid truncating a coalesced read.		*/
+	    auto setGRO (bool enable)					-> void;
+	    auto recvSegmented (void *buffer, size_t size,
+		    		std::vector<JSNSockView> &segments,
+		    		JSNSockAddress *from = nullptr)		-> size_t;
+    }; /* JSNSockUDP */
 } /* namespace jsnSock */
 #endif
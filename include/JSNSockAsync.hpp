@@ -0,0 +1,615 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+#ifndef _JSNSockAsync_HPP_
+#define _JSNSockAsync_HPP_
+
+/* Includes */
+#include "JSNSock.hpp"
+
+/* The library itself is C++11; this header is for applications built as	*/
+/* C++20 and is empty otherwise.  Everything here is defined inline.	*/
+#if defined(__cpp_impl_coroutine)
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>	/* used for 'close(2)' and 'write(2)' */
+#include <algorithm>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+/* Interface Declaration */
+namespace jsnSock
+{
+    /* JSNSockTask
+     * A detached coroutine: it starts at once, runs until its first
+     * suspension, and frees its own frame when it finishes.  An exception
+     * that escapes it ends the task (destroying whatever it owns) rather
+     * than the event loop that happened to resume it, and is logged at
+     * 'error' severity.
+     */
+    struct JSNSockTask
+    {
+	struct promise_type
+	{
+	    auto get_return_object ()					-> JSNSockTask
+	    { return JSNSockTask {}; }
+	    auto initial_suspend () noexcept				-> std::suspend_never
+	    { return {}; }
+	    auto final_suspend () noexcept				-> std::suspend_never
+	    { return {}; }
+	    auto return_void ()						-> void
+	    { }
+	    auto unhandled_exception ()					-> void
+	    {
+		try
+		{
+		    throw;
+		}
+		catch (const std::exception &e)
+		{
+		    JSN_LOG(error, "JSNSockTask: coroutine ended by an exception: %s", e.what());
+		}
+		catch (...)
+		{
+		    JSN_LOG(error, "JSNSockTask: coroutine ended by an unknown exception.");
+		}
+	    }
+	};
+    }; /* JSNSockTask */
+
+
+
+    /* JSNSockPending
+     * One suspended operation.  'attempt' runs the non-blocking system
+     * call and returns false on EAGAIN; the reactor callback calls it again
+     * on each readiness edge and resumes the coroutine once it succeeds.
+     * A failure is captured and rethrown from 'co_await'.
+     */
+    class JSNSockPending
+    {
+	protected:
+	    std::exception_ptr		failure;
+
+	    virtual auto perform ()					-> bool = 0;
+
+	public:
+	    std::coroutine_handle<>	handle;
+
+	    virtual ~JSNSockPending () = default;
+
+	    auto attempt ()						-> bool
+	    {
+		try
+		{
+		    return perform();
+		}
+		catch (...)
+		{
+		    failure = std::current_exception();
+		    return true;
+		}
+	    }
+
+	    auto rethrow ()						-> void
+	    {
+		if (failure)
+		    std::rethrow_exception(failure);
+	    }
+    }; /* JSNSockPending */
+
+
+
+    /* JSNSockWaiter
+     * Registers one descriptor with a reactor and resumes whichever
+     * coroutine is waiting to read from or write to it.  A descriptor has
+     * at most one reader and one writer waiting at a time.
+     */
+    class JSNSockWaiter
+    {
+	protected:
+	    JSNSockReactor	&reactor;
+	    int			fd;
+	    JSNSockPending	*reading = nullptr;
+	    JSNSockPending	*writing = nullptr;
+
+	    template <typename Op>
+	    struct awaiter
+	    {
+		Op		op;
+		JSNSockPending	*&slot;
+
+		auto await_ready ()					-> bool
+		{ return op.attempt(); }
+		auto await_suspend (std::coroutine_handle<> h)		-> void
+		{ op.handle = h; slot = &op; }
+		auto await_resume ()	-> decltype(std::declval<Op &>().result())
+		{ op.rethrow(); return op.result(); }
+	    };
+
+	    template <typename Op>
+	    auto readOp (Op op)						-> awaiter<Op>
+	    { return awaiter<Op> { std::move(op), reading }; }
+
+	    template <typename Op>
+	    auto writeOp (Op op)					-> awaiter<Op>
+	    { return awaiter<Op> { std::move(op), writing }; }
+
+	    /* The reactor callback; also called directly to retry a	*/
+	    /* pending operation woken by some other descriptor.	*/
+	    auto dispatch (uint32_t events)				-> void
+	    {
+		std::coroutine_handle<>	ready[2];
+		int			count = 0;
+		uint32_t		in = JSNSockReactor::readable
+					   | JSNSockReactor::hangup | JSNSockReactor::error;
+		uint32_t		out = JSNSockReactor::writable
+					    | JSNSockReactor::hangup | JSNSockReactor::error;
+
+		/* Collect first, resume after: a resumed coroutine	*/
+		/* may finish and destroy this waiter.			*/
+		if (reading && (events & in) && reading->attempt())
+		{
+		    ready[count++] = reading->handle;
+		    reading = nullptr;
+		}
+		if (writing && (events & out) && writing->attempt())
+		{
+		    ready[count++] = writing->handle;
+		    writing = nullptr;
+		}
+
+		for (int i = 0; i < count; i++)
+		    ready[i].resume();
+	    }
+
+	public:
+	    JSNSockWaiter (JSNSockReactor &reactor, int fd)
+	    : reactor(reactor), fd(fd)
+	    {
+		reactor.add(fd, JSNSockReactor::readable | JSNSockReactor::writable | JSNSockReactor::hangup,
+			[this](uint32_t events) { dispatch(events); });
+	    }
+
+	    ~JSNSockWaiter ()
+	    { reactor.remove(fd); }
+
+	    JSNSockWaiter (const JSNSockWaiter &)			= delete;
+	    auto operator= (const JSNSockWaiter &)			-> JSNSockWaiter & = delete;
+    }; /* JSNSockWaiter */
+
+
+
+    /* JSNSockStream
+     * Awaitable I/O on a connected (or connecting) socket, e.g.
+     *
+     *	JSNSockStream	stream(reactor, std::move(socket));
+     *	std::string	line = co_await stream.readline();
+     *	co_await stream.send(line + "\n");
+     *
+     * The socket is made non-blocking and its receive buffer is shared
+     * with the blocking API.  The stream must live on the reactor's thread
+     * and must not outlive the reactor.
+     */
+    class JSNSockStream : public JSNSockWaiter
+    {
+	private:
+	    JSNSockTCP	sock;
+
+	    struct recvInto : JSNSockPending
+	    {
+		JSNSockTCP	*socket;
+		void		*buffer;
+		size_t		size;
+		size_t		received = 0;
+
+		recvInto (JSNSockTCP *socket, void *buffer, size_t size)
+		: socket(socket), buffer(buffer), size(size)
+		{ }
+
+		auto perform ()						-> bool override
+		{
+		    JSNSockBuffer	&buffered = socket->recvBuffer;
+		    ssize_t		result;
+
+		    if (!buffered.empty())
+		    {
+			received = std::min(size, buffered.size());
+			memcpy(buffer, buffered.data(), received);
+			buffered.consume(received);
+			return true;
+		    }
+
+		    while ( (result = ::recv(socket->descriptor(), buffer, size, 0)) == -1 )
+		    {
+			if (errno == EAGAIN)
+			    return false;
+			if (errno != EINTR)
+			    throw JSNException("JSNSockStream: recv exception.");
+		    }
+
+		    received = result;	/* zero at end-of-stream */
+		    return true;
+		}
+
+		auto result ()						-> size_t
+		{ return received; }
+	    };
+
+	    struct recvString : recvInto
+	    {
+		std::string	data;
+
+		recvString (JSNSockTCP *socket, size_t size)
+		: recvInto(socket, nullptr, size), data(size, '\0')
+		{ }
+
+		recvString (recvString &&other)
+		: recvInto(other), data(std::move(other.data))
+		{ }
+
+		auto perform ()						-> bool override
+		{
+		    buffer = &data[0];
+		    return recvInto::perform();
+		}
+
+		auto result ()						-> std::string
+		{ data.resize(received); return std::move(data); }
+	    };
+
+	    struct readLine : JSNSockPending
+	    {
+		JSNSockTCP	*socket;
+		std::string	line;
+
+		readLine (JSNSockTCP *socket)
+		: socket(socket)
+		{ }
+
+		/* Same results as JSNSockTCP::readline */
+		auto perform ()						-> bool override
+		{
+		    JSNSockBuffer	&buffered = socket->recvBuffer;
+		    size_t		eol;
+		    ssize_t		result;
+
+		    while ( (eol = buffered.find('\n')) == JSNSockBuffer::npos )
+		    {
+			if (buffered.size() == buffered.capacity())
+			    buffered.reserve(buffered.capacity());
+
+			char	*space = buffered.space();
+			result = ::recv(socket->descriptor(), space, buffered.spaceSize(), 0);
+
+			if (result > 0)
+			    buffered.commit(result);
+			else if (result == 0)
+			{
+			    eol = buffered.size();	/* EOF: hand back whatever is left */
+			    break;
+			}
+			else if (errno == EAGAIN)
+			    return false;
+			else if (errno != EINTR)
+			    throw JSNException("JSNSockStream: recv exception.");
+		    }
+
+		    bool	complete = eol < buffered.size();
+
+		    line.assign(buffered.data(), eol);
+		    buffered.consume(complete ? eol + 1 : eol);
+		    line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+
+		    if (complete && line.empty())
+			line = "\r";	/* an empty line is distinguished from EOF */
+		    return true;
+		}
+
+		auto result ()						-> std::string
+		{ return std::move(line); }
+	    };
+
+	    struct sendAll : JSNSockPending
+	    {
+		JSNSockTCP	*socket;
+		std::string	owned;
+		const char	*data;
+		size_t		size;
+		size_t		sent = 0;
+
+		sendAll (JSNSockTCP *socket, const void *data, size_t size)
+		: socket(socket), data(static_cast<const char *>(data)), size(size)
+		{ }
+
+		sendAll (JSNSockTCP *socket, std::string data)
+		: socket(socket), owned(std::move(data)), data(nullptr), size(owned.size())
+		{ }
+
+		sendAll (sendAll &&other)
+		: JSNSockPending(other), socket(other.socket), owned(std::move(other.owned)),
+		  data(other.data), size(other.size), sent(other.sent)
+		{ }
+
+		auto perform ()						-> bool override
+		{
+		    const char	*bytes = data ? data : owned.data();
+		    ssize_t	result;
+
+		    while (sent < size)
+		    {
+			result = ::send(socket->descriptor(), bytes + sent, size - sent, MSG_NOSIGNAL);
+
+			if (result >= 0)
+			    sent += result;
+			else if (errno == EAGAIN)
+			    return false;
+			else if (errno != EINTR)
+			    throw JSNException("JSNSockStream: exception during attempt to send.");
+		    }
+		    return true;
+		}
+
+		auto result ()						-> void
+		{ }
+	    };
+
+	    /* A host name lookup in flight on the resolver's worker; shared	*/
+	    /* with its callback, which may outlive the stream.			*/
+	    struct lookup
+	    {
+		std::mutex			lock;
+		JSNSockResolver::addresses	result;
+		int				error = 0;
+		bool				done = false;
+		int				wakeDesc;
+
+		lookup ()
+		{
+		    if ( (wakeDesc = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1 )
+			throw JSNException("JSNSockStream: unable to create a lookup eventfd.");
+		}
+
+		~lookup ()
+		{ ::close(wakeDesc); }
+	    };
+
+	    struct connectTo : JSNSockPending
+	    {
+		JSNSockStream		*stream;
+		std::string		host;
+		uint16_t		port;
+		std::shared_ptr<lookup>	resolving;	/* set while waiting for the worker */
+		JSNSockAddress		address;
+		bool			resolved = false;
+		bool			started = false;
+
+		connectTo (JSNSockStream *stream, const std::string &host, uint16_t port)
+		: stream(stream), host(host), port(port)
+		{ }
+
+		connectTo (connectTo &&other)
+		: JSNSockPending(other), stream(other.stream), host(std::move(other.host)), port(other.port),
+		  resolving(std::move(other.resolving)), address(other.address),
+		  resolved(other.resolved), started(other.started)
+		{ }
+
+		~connectTo ()
+		{
+		    if (resolving)
+			stream->reactor.remove(resolving->wakeDesc);
+		}
+
+		/* Numeric and cached names are answered at once; anything	*/
+		/* else goes to the resolver's worker, whose callback wakes	*/
+		/* the reactor through an eventfd and so retries this op.	*/
+		auto resolve ()						-> bool
+		{
+		    JSNSockResolver::addresses	found;
+		    int				error = 0;
+
+		    if (!resolving)
+		    {
+			if (!JSNSockResolver::shared().cached(host, stream->sock.domain, found))
+			{
+			    std::shared_ptr<lookup>	state = std::make_shared<lookup>();
+			    JSNSockStream		*owner = stream;
+
+			    stream->reactor.add(state->wakeDesc, JSNSockReactor::readable,
+				    [owner](uint32_t /* events */) { owner->dispatch(JSNSockReactor::writable); });
+			    resolving = state;
+
+			    JSNSockResolver::shared().resolveAsync(host, stream->sock.domain,
+				    [state](const JSNSockResolver::addresses &result, int error)
+				    {
+					uint64_t	one = 1;
+					{
+					    std::lock_guard<std::mutex>	guard(state->lock);
+					    state->result = result;
+					    state->error = error;
+					    state->done = true;
+					}
+					while (::write(state->wakeDesc, &one, sizeof(one)) == -1 && errno == EINTR)
+					    ;
+				    });
+			    return false;
+			}
+		    }
+		    else
+		    {
+			std::lock_guard<std::mutex>	guard(resolving->lock);
+
+			if (!resolving->done)
+			    return false;
+			found = std::move(resolving->result);
+			error = resolving->error;
+		    }
+
+		    if (resolving)
+		    {
+			stream->reactor.remove(resolving->wakeDesc);
+			resolving.reset();
+		    }
+
+		    if (error == 0 && found.empty())
+			error = EADDRNOTAVAIL;
+		    if (error)
+		    {
+			errno = error;
+			throw JSNException("JSNSockStream: unable to resolve host name.");
+		    }
+
+		    address = found.front();
+		    address.setPort(port);
+		    resolved = true;
+		    return true;
+		}
+
+		auto perform ()						-> bool override
+		{
+		    int		sockDesc = stream->sock.descriptor();
+
+		    if (!resolved && !resolve())
+			return false;
+
+		    if (!started)
+		    {
+			started = true;
+			if ( ::connect(sockDesc, address.sockaddr(), address.length) == 0 )
+			    return true;
+			if (errno == EINPROGRESS || errno == EINTR)
+			    return false;
+			throw JSNException("JSNSockStream: connect exception.");
+		    }
+
+		    int		error = 0;
+		    socklen_t	length = sizeof(error);
+
+		    if ( getsockopt(sockDesc, SOL_SOCKET, SO_ERROR, &error, &length) == -1 )
+			throw JSNException("JSNSockStream: connect exception.");
+		    if (error == EINPROGRESS || error == EALREADY)
+			return false;
+		    if (error != 0)
+		    {
+			errno = error;
+			throw JSNException("JSNSockStream: connect exception.");
+		    }
+		    return true;
+		}
+
+		auto result ()						-> void
+		{ }
+	    };
+
+	public:
+	    /* 'socket' may be connected already, or fresh for 'connect' */
+	    JSNSockStream (JSNSockReactor &reactor, JSNSockTCP &&socket = JSNSockTCP())
+	    : JSNSockWaiter(reactor, socket.descriptor()), sock(std::move(socket))
+	    { sock.setBlocking(false); }
+
+	    auto socket ()						-> JSNSockTCP &
+	    { return sock; }
+
+	    /* Connect to the first address of 'host' for the socket's	*/
+	    /* family.  Both the lookup (unless numeric or cached) and	*/
+	    /* the handshake are awaited; neither blocks the reactor.	*/
+	    auto connect (const std::string &host, uint16_t port)
+	    { return writeOp(connectTo(this, host, port)); }
+
+	    /* Up to 'size' bytes (zero at end-of-stream) */
+	    auto recv (void *buffer, size_t size)
+	    { return readOp(recvInto(&sock, buffer, size)); }
+	    auto recv (size_t size)
+	    { return readOp(recvString(&sock, size)); }
+
+	    auto readline ()
+	    { return readOp(readLine(&sock)); }
+
+	    /* The whole buffer; 'buffer' must stay valid until resumed */
+	    auto send (const void *buffer, size_t size)
+	    { return writeOp(sendAll(&sock, buffer, size)); }
+	    auto send (std::string data)
+	    { return writeOp(sendAll(&sock, std::move(data))); }
+    }; /* JSNSockStream */
+
+
+
+    /* JSNSockListener
+     * Awaitable accept on a listening server socket:
+     *
+     *	JSNSockListener	listener(reactor, server);
+     *	for (;;)
+     *	    session(reactor, co_await listener.accept());
+     */
+    class JSNSockListener : public JSNSockWaiter
+    {
+	private:
+	    struct acceptOne : JSNSockPending
+	    {
+		int		listenDesc;
+		JSNSockTCP	accepted;
+
+		acceptOne (int listenDesc)
+		: listenDesc(listenDesc)
+		{ }
+
+		acceptOne (acceptOne &&other)
+		: JSNSockPending(other), listenDesc(other.listenDesc), accepted(std::move(other.accepted))
+		{ }
+
+		auto perform ()						-> bool override
+		{
+		    int		peerSockDesc;
+
+		    while ( (peerSockDesc = ::accept4(listenDesc, nullptr, nullptr,
+				    SOCK_NONBLOCK | SOCK_CLOEXEC)) == -1 )
+		    {
+			if (errno == EAGAIN)
+			    return false;
+			if (errno != EINTR && errno != ECONNABORTED)
+			    throw JSNException("JSNSockListener: accept exception.");
+		    }
+
+		    accepted = JSNSockTCP(peerSockDesc, 0.0);
+		    return true;
+		}
+
+		auto result ()						-> JSNSockTCP
+		{ return std::move(accepted); }
+	    };
+
+	public:
+	    /* 'server' must be listening already and outlive the listener */
+	    JSNSockListener (JSNSockReactor &reactor, JSNSockTCPServer &server)
+	    : JSNSockWaiter(reactor, server.descriptor())
+	    { server.setBlocking(false); }
+
+	    auto accept ()
+	    { return readOp(acceptOne(fd)); }
+    }; /* JSNSockListener */
+} /* namespace jsnSock */
+#endif /* __cpp_impl_coroutine */
+#endif
@@ -0,0 +1,194 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+
+#ifndef _JSNSockBuffer_HPP_
+#define _JSNSockBuffer_HPP_
+#define JSN_RECVBUF_CAPACITY 16384
+#define JSN_POOL_CLASSES 9		/* size classes 256 B .. 64 KiB */
+#define JSN_POOL_KEEP 64		/* blocks cached per class, per thread */
+
+/* Includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/* Interface Declaration */
+namespace jsnSock
+{
+    /* JSNSockView
+     * A non-owning view of bytes held elsewhere (usually a JSNSockBuffer).
+     * It is only valid until the owner is next filled or consumed.
+     */
+    struct JSNSockView
+    {
+	const char	*data;
+	size_t		size;
+
+	auto empty () const					-> bool
+	{ return size == 0; }
+	auto str () const					-> std::string
+	{ return std::string(data, size); }
+    }; /* JSNSockView */
+
+
+
+    /* JSNSockBuffer
+     * A contiguous byte buffer filled at the tail and consumed at the head.
+     * Storage is allocated on first use, so idle sockets cost nothing, and
+     * unread bytes are moved to the front only when the tail runs out.
+     */
+    class JSNSockBuffer
+    {
+	private:
+	    std::vector<char>	storage;
+	    size_t		limit;		/* capacity to allocate on first use */
+	    size_t		head;		/* first unread byte */
+	    size_t		tail;		/* one past the last unread byte */
+
+	public:
+	    static const size_t	npos = static_cast<size_t>(-1);
+
+	    JSNSockBuffer (size_t capacity = JSN_RECVBUF_CAPACITY);
+
+	    /* Moving leaves the source empty (but still usable) */
+	    JSNSockBuffer (JSNSockBuffer &&other) noexcept;
+	    auto operator= (JSNSockBuffer &&other) noexcept		-> JSNSockBuffer &;
+
+	    /* Unread bytes */
+	    auto data () const						-> const char *
+	    { return storage.data() + head; }
+	    auto size () const						-> size_t
+	    { return tail - head; }
+	    auto empty () const						-> bool
+	    { return tail == head; }
+	    auto view () const						-> JSNSockView
+	    { return JSNSockView { data(), size() }; }
+	    auto capacity () const					-> size_t
+	    { return storage.empty() ? limit : storage.size(); }
+
+	    /* Offset of the first 'c' in the unread bytes, or 'npos' */
+	    auto find (char c) const					-> size_t
+	    {
+		const void *at = empty() ? nullptr : memchr(data(), c, size());
+		return at ? static_cast<const char *>(at) - data() : npos;
+	    }
+
+	    /* Discard 'n' unread bytes */
+	    auto consume (size_t n)					-> void;
+
+	    /* Free space at the tail, allocating and compacting as needed;	*/
+	    /* write into 'space()' then 'commit' the number of bytes written.	*/
+	    auto space ()						-> char *;
+	    auto spaceSize () const					-> size_t
+	    { return capacity() - tail; }
+	    auto commit (size_t n)					-> void
+	    { tail += n; }
+
+	    /* Ensure at least 'n' bytes of free space (may grow the buffer) */
+	    auto reserve (size_t n)					-> void;
+
+	    /* Change the capacity; never drops unread bytes */
+	    auto resize (size_t capacity)				-> void;
+
+	    auto clear ()						-> void
+	    { head = tail = 0; }
+    }; /* JSNSockBuffer */
+
+
+
+    /* JSNSockLease
+     * A block borrowed from the calling thread's JSNSockBufferPool.  It is
+     * handed back (to whichever thread destroys it) automatically.
+     */
+    class JSNSockLease
+    {
+	private:
+	    char		*block;
+	    size_t		blockSize;	/* capacity */
+	    size_t		length;		/* bytes in use */
+	    uint32_t		sizeClass;
+
+	    friend class JSNSockBufferPool;
+	    JSNSockLease (char *block, size_t blockSize, uint32_t sizeClass)
+	    : block(block), blockSize(blockSize), length(0), sizeClass(sizeClass)
+	    {}
+
+	public:
+	    JSNSockLease ()
+	    : block(nullptr), blockSize(0), length(0), sizeClass(0)
+	    {}
+	    ~JSNSockLease ();
+
+	    JSNSockLease (const JSNSockLease &)				= delete;
+	    auto operator= (const JSNSockLease &)			-> JSNSockLease & = delete;
+	    JSNSockLease (JSNSockLease &&other) noexcept;
+	    auto operator= (JSNSockLease &&other) noexcept		-> JSNSockLease &;
+
+	    auto data ()						-> char *
+	    { return block; }
+	    auto capacity () const					-> size_t
+	    { return blockSize; }
+	    auto size () const						-> size_t
+	    { return length; }
+	    auto resize (size_t size)					-> void
+	    { length = (size < blockSize) ? size : blockSize; }
+	    auto view () const						-> JSNSockView
+	    { return JSNSockView { block, length }; }
+    }; /* JSNSockLease */
+
+
+
+    /* JSNSockBufferPool
+     * Per-thread free lists of power-of-two blocks, so steady-state
+     * receives reuse memory instead of calling the allocator.  Requests
+     * larger than the biggest class are served (and freed) directly.
+     */
+    class JSNSockBufferPool
+    {
+	private:
+	    std::vector<char *>	freeList[JSN_POOL_CLASSES];
+
+	    JSNSockBufferPool () = default;
+
+	public:
+	    static const size_t	smallest = 256;
+	    static const size_t	largest = smallest << (JSN_POOL_CLASSES - 1);
+
+	    ~JSNSockBufferPool ();
+
+	    JSNSockBufferPool (const JSNSockBufferPool &)		= delete;
+	    auto operator= (const JSNSockBufferPool &)			-> JSNSockBufferPool & = delete;
+
+	    /* The calling thread's pool */
+	    static auto local ()					-> JSNSockBufferPool &;
+
+	    /* Borrow at least 'size' bytes from the calling thread's pool */
+	    static auto lease (size_t size)				-> JSNSockLease;
+
+	    auto take (size_t size)					-> JSNSockLease;
+	    auto give (char *block, uint32_t sizeClass)			-> void;
+    }; /* JSNSockBufferPool */
+} /* namespace jsnSock */
+#endif
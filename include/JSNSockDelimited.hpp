@@ -0,0 +1,115 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+#ifndef _JSNSockDelimited_HPP_
+#define _JSNSockDelimited_HPP_
+#define JSN_LINE_MAX (64 * 1024)	/* default longest line, delimiter excluded */
+#define JSN_SCAN_BATCH 64		/* matches collected per pass of the scanning kernel */
+
+/* Includes */
+#include "JSNSock.hpp"
+
+/* Interface Declaration */
+namespace jsnSock
+{
+    /* JSNSockDelimiter
+     * Finds a delimiter -- any non-empty byte sequence: "\n", "\r\n", a
+     * NUL, "\r\n\r\n" -- in received bytes.  Candidates are found 16 or
+     * 32 positions at a time by matching the delimiter's first and last
+     * bytes with SSE2 or AVX2 (picked at run time; memchr elsewhere, or
+     * when built with JSN_NO_SIMD) and confirmed with memcmp.  Matches
+     * never overlap.
+     */
+    class JSNSockDelimiter
+    {
+	private:
+	    std::string		sequence;
+
+	public:
+	    static const size_t	npos = static_cast<size_t>(-1);
+
+	    JSNSockDelimiter (const std::string &sequence = "\n");
+
+	    auto size () const						-> size_t
+	    { return sequence.size(); }
+	    auto str () const						-> const std::string &
+	    { return sequence; }
+
+	    /* Offset of the first match; 'from' bytes are known to hold	*/
+	    /* no match's start and are skipped.  'npos' if there is none.	*/
+	    auto find (const char *data, size_t size, size_t from = 0) const	-> size_t;
+
+	    /* One pass: a view of every delimited token, delimiters left	*/
+	    /* out, appended to 'tokens'.  Returns the bytes used: up to and	*/
+	    /* including the last delimiter.					*/
+	    auto split (const char *data, size_t size,
+		    	std::vector<JSNSockView> &tokens, size_t from = 0) const	-> size_t;
+
+	    /* The kernel in use: "avx2", "sse2" or "scalar" */
+	    static auto engine ()					-> const char *;
+
+	    /* Force one of those kernels process-wide (to compare them),	*/
+	    /* or the run-time choice again with "".  Throws (EINVAL) if	*/
+	    /* this build or CPU lacks it.					*/
+	    static auto setEngine (const std::string &name)		-> void;
+    }; /* JSNSockDelimiter */
+
+
+
+    /* JSNSockDelimitedChannel
+     * Delimited records (lines, NUL-terminated tokens) over a JSNSockTCP,
+     * split in place in the socket's receive buffer.  Every record handed
+     * back is a view into that buffer, valid until the next 'next' or
+     * 'receive' call on the channel (or any other read from the socket).
+     * A record longer than 'maxLine' is an error; bytes left without a
+     * delimiter at end-of-stream are handed back as a last record.
+     */
+    class JSNSockDelimitedChannel
+    {
+	private:
+	    JSNSockTCP		&socket;
+	    JSNSockDelimiter	delimiter;
+	    size_t		maxLine;
+	    size_t		pending;	/* bytes of records already handed out */
+	    size_t		scanned;	/* buffered bytes known to start no delimiter */
+
+	    auto release ()						-> void;
+	    auto check (size_t length)					-> void;
+
+	    /* Read more after a fruitless scan; false at end-of-stream */
+	    auto more ()						-> bool;
+
+	public:
+	    JSNSockDelimitedChannel (JSNSockTCP &socket,
+		    		     const std::string &delimiter = "\n",
+				     size_t maxLine = JSN_LINE_MAX);
+
+	    /* One record; false at a clean end-of-stream */
+	    auto next (JSNSockView &record)				-> bool;
+
+	    /* Every complete record in the buffer from one scan, reading	*/
+	    /* only while none is complete; returns the count, zero at	*/
+	    /* end-of-stream.							*/
+	    auto receive (std::vector<JSNSockView> &records)		-> size_t;
+    }; /* JSNSockDelimitedChannel */
+} /* namespace jsnSock */
+#endif
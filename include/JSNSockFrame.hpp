@@ -0,0 +1,82 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+
+#ifndef _JSNSockFrame_HPP_
+#define _JSNSockFrame_HPP_
+#define JSN_FRAME_MAX (16 * 1024 * 1024)
+
+/* Includes */
+#include "JSNSock.hpp"
+
+/* Interface Declaration */
+namespace jsnSock
+{
+    /* JSNSockFramedChannel
+     * Length-prefixed messages over a JSNSockTCP.  Frames are parsed in
+     * place from the socket's receive buffer: every frame handed back is
+     * a view into that buffer, valid until the next 'next' or 'receive'
+     * call on the channel (or any other read from the socket).
+     */
+    class JSNSockFramedChannel
+    {
+	public:
+	    enum prefix : uint32_t
+	    {
+		fixed32,	/* 4 bytes, network byte order */
+		varint		/* LEB128, 1 to 10 bytes */
+	    };
+
+	private:
+	    JSNSockTCP		&socket;
+	    uint32_t		format;
+	    size_t		maxFrame;
+	    size_t		pending;	/* bytes of frames already handed out */
+
+	    /* Decode the frame at 'data'; false if it is not complete yet.	*/
+	    /* 'header' is always set once the prefix itself is complete.	*/
+	    auto decode (const char *data, size_t available,
+		    	size_t &header, size_t &body)			-> bool;
+
+	    /* Make room for and read more bytes; false at end-of-stream */
+	    auto more (size_t needed)					-> bool;
+
+	public:
+	    JSNSockFramedChannel (JSNSockTCP &socket,
+		    		  uint32_t format = fixed32,
+				  size_t maxFrame = JSN_FRAME_MAX);
+
+	    /* Prefix and payload leave in a single sendmsg(2) */
+	    auto send (const void *frame, size_t size, bool more = false)	-> void;
+	    auto send (const std::string &frame)			-> void
+	    { send(frame.data(), frame.size()); }
+
+	    /* One frame; false at a clean end-of-stream */
+	    auto next (JSNSockView &frame)				-> bool;
+
+	    /* Every complete frame in the buffer, reading only while none	*/
+	    /* is complete yet (until at least one is); returns the count,	*/
+	    /* zero at end-of-stream.						*/
+	    auto receive (std::vector<JSNSockView> &frames)		-> size_t;
+    }; /* JSNSockFramedChannel */
+} /* namespace jsnSock */
+#endif
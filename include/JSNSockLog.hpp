@@ -0,0 +1,192 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+#ifndef _JSNSockLog_HPP_
+#define _JSNSockLog_HPP_
+#define JSN_LOG_LINE 256		/* bytes per message, prefix and newline included; longer ones are cut */
+#define JSN_LOG_RING 1024		/* messages a JSNSockLogRing holds by default */
+#ifndef JSN_LOG_COMPILED
+#define JSN_LOG_COMPILED 0		/* lowest level built in: 0 trace, 1 debug ... 4 error, 5 none */
+#endif
+
+#ifdef __GNUC__
+#define JSN_LOG_FORMAT(string, first) __attribute__((__format__(__printf__, string, first)))
+#else
+#define JSN_LOG_FORMAT(string, first)
+#endif
+
+/* Log a printf-style message at 'severity' (trace, debug, info, warning	*/
+/* or error).  Below JSN_LOG_COMPILED the statement compiles to nothing;	*/
+/* below the run-time level it costs one relaxed load, and in neither case	*/
+/* are the arguments evaluated.						*/
+#define JSN_LOG(severity, ...)							\
+    do {									\
+	if (jsnSock::JSNSockLog::severity >= JSN_LOG_COMPILED &&		\
+		jsnSock::JSNSockLog::enabled(jsnSock::JSNSockLog::severity))	\
+	    jsnSock::JSNSockLog::write(jsnSock::JSNSockLog::severity, __VA_ARGS__);	\
+    } while (0)
+
+/* Includes */
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/* Interface Declaration */
+namespace jsnSock
+{
+    class JSNSockLogSink;
+
+    /* JSNSockLog
+     * The library's diagnostics.  Messages at or above the run-time level
+     * (warning by default, so a server logs nothing while all is well)
+     * are formatted on the calling thread into a fixed buffer and handed
+     * to the current sink; without one they go to standard error with a
+     * single write(2) and no iostream lock.
+     */
+    class JSNSockLog
+    {
+	public:
+	    enum level : uint32_t
+	    {
+		trace,
+		debug,
+		info,
+		warning,
+		error,
+		none		/* as a threshold: log nothing */
+	    };
+
+	private:
+	    static std::atomic<uint32_t>		threshold;
+	    static std::atomic<JSNSockLogSink *>	current;
+
+	    friend class JSNSockLogRing;	/* uninstalls itself on destruction */
+
+	public:
+	    static auto name (level severity)				-> const char *;
+
+	    static auto setLevel (level lowest)				-> void;
+	    static auto enabled (level severity)			-> bool
+	    { return severity >= threshold.load(std::memory_order_relaxed); }
+
+	    /* The sink must outlive its use; nullptr restores standard error */
+	    static auto setSink (JSNSockLogSink *sink)			-> void;
+	    static auto sink ()						-> JSNSockLogSink *
+	    { return current.load(std::memory_order_acquire); }
+
+	    /* Unconditional: JSN_LOG checks the level first */
+	    JSN_LOG_FORMAT(2, 3)
+	    static auto write (level severity, const char *format, ...)	-> void;
+    }; /* JSNSockLog */
+
+
+
+    /* JSNSockLogSink
+     * Receives each message as one line, prefix and newline included; the
+     * text is only valid for the duration of the call.  'write' may be
+     * called from any number of threads at once.
+     */
+    class JSNSockLogSink
+    {
+	public:
+	    virtual ~JSNSockLogSink () {}
+	    virtual auto write (JSNSockLog::level severity, const char *line, size_t size)	-> void = 0;
+    }; /* JSNSockLogSink */
+
+
+
+    /* JSNSockLogDescriptor
+     * Writes each line to a file descriptor (standard error by default)
+     * with one write(2), so lines from different threads do not interleave.
+     */
+    class JSNSockLogDescriptor : public JSNSockLogSink
+    {
+	private:
+	    int		descriptor;
+
+	public:
+	    JSNSockLogDescriptor (int descriptor = 2)
+	    : descriptor(descriptor) {}
+
+	    auto write (JSNSockLog::level severity, const char *line, size_t size)	-> void;
+    }; /* JSNSockLogDescriptor */
+
+
+
+    /* JSNSockLogRing
+     * An asynchronous sink: 'write' copies the line into a bounded
+     * lock-free ring (multi-producer, one consumer) and returns; a thread
+     * of the ring's own hands lines to the 'target' sink in order.  When
+     * the ring is full the line is dropped and counted, never waited for;
+     * the count is reported through the target once there is room.  Set
+     * another sink before destroying a ring that is in use.
+     */
+    class JSNSockLogRing : public JSNSockLogSink
+    {
+	private:
+	    struct slot
+	    {
+		std::atomic<uint64_t>	sequence;	/* == position + 1 once written */
+		JSNSockLog::level	severity;
+		uint32_t		size;
+		char			line[JSN_LOG_LINE];
+	    };
+
+	    JSNSockLogDescriptor	standardError;
+	    JSNSockLogSink		&target;
+	    std::unique_ptr<slot[]>	slots;
+	    uint64_t			mask;
+	    std::atomic<uint64_t>	head;		/* next position for a producer */
+	    std::atomic<uint64_t>	tail;		/* next position for the consumer */
+	    std::atomic<uint64_t>	dropped;
+	    uint64_t			reported = 0;	/* consumer only: drops already reported */
+
+	    std::mutex			lock;
+	    std::condition_variable	ready;
+	    std::atomic<bool>		sleeping;
+	    bool			stopping = false;
+	    std::thread			worker;
+
+	    auto work ()						-> void;
+
+	public:
+	    /* 'capacity' is rounded up to a power of two; without a	*/
+	    /* target, lines go to standard error.			*/
+	    JSNSockLogRing (JSNSockLogSink *target = nullptr, size_t capacity = JSN_LOG_RING);
+	    ~JSNSockLogRing ();
+
+	    JSNSockLogRing (const JSNSockLogRing &)			= delete;
+	    auto operator= (const JSNSockLogRing &)			-> JSNSockLogRing & = delete;
+
+	    auto write (JSNSockLog::level severity, const char *line, size_t size)	-> void;
+
+	    /* Wait until every line written before the call has reached the target */
+	    auto flush ()						-> void;
+	    auto lost () const						-> uint64_t
+	    { return dropped.load(std::memory_order_relaxed); }
+    }; /* JSNSockLogRing */
+} /* namespace jsnSock */
+#endif
@@ -0,0 +1,196 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+#ifndef _JSNSockMetrics_HPP_
+#define _JSNSockMetrics_HPP_
+#define JSN_METRICS_SHARDS 16		/* counter shards; threads take them round-robin */
+#define JSN_HISTOGRAM_SUB_BITS 4	/* 16 buckets per power of two: within 6.25% */
+
+/* Includes */
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Interface Declaration */
+namespace jsnSock
+{
+    /* JSNSockCounters
+     * A copy of a set of counters, indexed by 'counter'.
+     */
+    struct JSNSockCounters
+    {
+	enum counter : uint32_t
+	{
+	    bytesSent,
+	    bytesReceived,
+	    sends,		/* send-side system calls */
+	    recvs,		/* receive-side system calls */
+	    partialWrites,	/* sends that took less than offered */
+	    wouldBlock,		/* EAGAIN from either side */
+	    accepts,
+	    acceptErrors,	/* failed accepts a server survived (EMFILE, ENOBUFS, ...) */
+	    connects,
+	    counters
+	};
+
+	uint64_t	value[counters] = {};
+
+	static auto name (counter c)					-> const char *;
+
+	auto operator[] (counter c) const				-> uint64_t
+	{ return value[c]; }
+	auto operator+= (const JSNSockCounters &other)			-> JSNSockCounters &;
+    }; /* JSNSockCounters */
+
+
+
+    /* JSNSockHistogram
+     * HDR-style latency histogram over nanoseconds: exact below 16, then
+     * 16 linear buckets per power of two, so any recorded value is
+     * reported within 6.25% across the whole 64-bit range.  This is the
+     * plain (snapshot) form; live histograms are kept by JSNSockMetrics.
+     */
+    class JSNSockHistogram
+    {
+	public:
+	    static const uint32_t	sub	= 1u << JSN_HISTOGRAM_SUB_BITS;
+	    static const uint32_t	buckets	= (64 - JSN_HISTOGRAM_SUB_BITS + 1) << JSN_HISTOGRAM_SUB_BITS;
+
+	    static auto bucket (uint64_t value)				-> uint32_t
+	    {
+		if (value < sub)
+		    return value;
+
+		uint32_t	shift = 63 - __builtin_clzll(value) - JSN_HISTOGRAM_SUB_BITS;
+		return ((shift + 1) << JSN_HISTOGRAM_SUB_BITS) + uint32_t(value >> shift) - sub;
+	    }
+
+	    /* The highest value that lands in 'bucket' */
+	    static auto highest (uint32_t bucket)			-> uint64_t;
+
+	    std::vector<uint64_t>	counts;
+	    uint64_t			total	= 0;
+	    uint64_t			sum	= 0;	/* of recorded values */
+
+	    JSNSockHistogram ()
+	    : counts(buckets)
+	    { }
+
+	    auto record (uint64_t value)				-> void;
+	    auto operator+= (const JSNSockHistogram &other)		-> JSNSockHistogram &;
+
+	    /* 'fraction' in [0, 1]; zero when empty */
+	    auto percentile (double fraction) const			-> uint64_t;
+	    auto mean () const						-> uint64_t
+	    { return total ? sum / total : 0; }
+	    auto max () const						-> uint64_t
+	    { return percentile(1.0); }
+    }; /* JSNSockHistogram */
+
+
+
+    /* JSNSockMetrics
+     * Process-wide counters and latency histograms, off until 'enable'.
+     * Each thread updates its own shard with relaxed atomics (threads
+     * beyond JSN_METRICS_SHARDS share), so recording never contends on
+     * one cache line; 'collect' sums the shards.  Disabled, a recording
+     * costs one relaxed load and no clock reads.
+     */
+    class JSNSockMetrics
+    {
+	public:
+	    enum histogram : uint32_t
+	    {
+		connectTime,	/* connect(2) until established */
+		sendWait,	/* blocked in poll(2) for writability */
+		recvWait,	/* blocked in poll(2) for readability */
+		histograms	/* also: record nothing */
+	    };
+
+	    struct snapshot
+	    {
+		JSNSockCounters		counters;
+		JSNSockHistogram	latency[histograms];
+	    };
+
+	private:
+	    static std::atomic<bool>	active;
+
+	    static auto count (JSNSockCounters::counter c, uint64_t n)	-> void;
+
+	public:
+	    static auto name (histogram h)				-> const char *;
+
+	    static auto enable (bool on = true)				-> void;
+	    static auto enabled ()					-> bool
+	    { return active.load(std::memory_order_relaxed); }
+
+	    static auto add (JSNSockCounters::counter c, uint64_t n = 1)	-> void
+	    {
+		if (enabled())
+		    count(c, n);
+	    }
+	    static auto record (histogram h, uint64_t nanoseconds)	-> void;
+
+	    /* Sum of every shard; counts recorded meanwhile may be missed */
+	    static auto collect ()					-> snapshot;
+	    static auto reset ()					-> void;
+
+	    /* One "jsnsock_<name> <value>" line per counter and, per	*/
+	    /* histogram, its count, sum, mean and p50/p90/p99/p999/max.	*/
+	    static auto text (const snapshot &metrics)			-> std::string;
+	    static auto text ()						-> std::string
+	    { return text(collect()); }
+    }; /* JSNSockMetrics */
+
+
+
+    /* JSNSockCounterSet
+     * The live counters of one socket.  Only the thread doing the
+     * socket's I/O writes them (load and store, no locked instruction);
+     * any thread may read a consistent-per-counter 'snapshot'.  Every
+     * update is also added to the process-wide JSNSockMetrics.
+     */
+    class JSNSockCounterSet
+    {
+	private:
+	    std::atomic<uint64_t>	value[JSNSockCounters::counters];
+
+	public:
+	    JSNSockCounterSet ();
+
+	    /* Copies (and so moves of the owning socket) take a snapshot */
+	    JSNSockCounterSet (const JSNSockCounterSet &other);
+	    auto operator= (const JSNSockCounterSet &other)		-> JSNSockCounterSet &;
+
+	    auto add (JSNSockCounters::counter c, uint64_t n = 1)	-> void
+	    {
+		value[c].store(value[c].load(std::memory_order_relaxed) + n,
+			std::memory_order_relaxed);
+		JSNSockMetrics::add(c, n);
+	    }
+
+	    auto snapshot () const					-> JSNSockCounters;
+    }; /* JSNSockCounterSet */
+} /* namespace jsnSock */
+#endif
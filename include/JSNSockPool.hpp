@@ -0,0 +1,120 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+
+#ifndef _JSNSockPool_HPP_
+#define _JSNSockPool_HPP_
+#define JSN_POOL_PER_HOST 8		/* connections (idle + leased) per endpoint */
+#define JSN_POOL_IDLE_TIMEOUT 60.0	/* seconds an idle connection is kept */
+
+/* Includes */
+#include "JSNSock.hpp"
+#include <condition_variable>
+#include <mutex>
+
+/* Interface Declaration */
+namespace jsnSock
+{
+    /* JSNSockTCPPool
+     * Client-side connections kept open per host:port and handed out
+     * again, so a request does not pay for a handshake and slow start.
+     * Idle connections run with SO_KEEPALIVE and are checked (one poll(2),
+     * no data read) before reuse.  The pool must outlive its leases.
+     */
+    class JSNSockTCPPool
+    {
+	public:
+	    /* A borrowed connection, returned to the pool when destroyed.	*/
+	    /* Call 'discard' if the connection may be in an unknown state	*/
+	    /* (e.g. after an exception mid-request).				*/
+	    class lease
+	    {
+		private:
+		    JSNSockTCPPool	*pool;
+		    std::string		key;
+		    JSNSockTCP		socket;
+
+		    friend class JSNSockTCPPool;
+		    lease (JSNSockTCPPool *pool, const std::string &key, JSNSockTCP &&socket)
+		    : pool(pool), key(key), socket(std::move(socket))
+		    {}
+
+		public:
+		    lease (lease &&other) noexcept;
+		    auto operator= (lease &&other) noexcept		-> lease & = delete;
+		    ~lease ();
+
+		    auto operator-> ()					-> JSNSockTCP *
+		    { return &socket; }
+		    auto operator* ()					-> JSNSockTCP &
+		    { return socket; }
+
+		    auto discard ()					-> void;
+	    }; /* lease */
+
+	private:
+	    typedef std::chrono::steady_clock	clock;
+
+	    struct endpoint
+	    {
+		std::vector<std::pair<JSNSockTCP, clock::time_point>>	idle;	/* most recent last */
+		uint32_t						open = 0;	/* idle + leased */
+	    };
+
+	    std::mutex					lock;
+	    std::condition_variable			returned;
+	    std::unordered_map<std::string, endpoint>	endpoints;
+	    uint32_t					maxPerHost;
+	    clock::duration				idleTimeout;
+	    double					timeout;
+
+	    auto give (const std::string &key, JSNSockTCP &&socket)	-> void;
+	    auto forget (const std::string &key)			-> void;
+	    auto open (const std::string &host, uint16_t port)		-> JSNSockTCP;
+
+	public:
+	    /* 'timeout' applies to connect and to I/O on pooled sockets */
+	    JSNSockTCPPool (uint32_t maxPerHost = JSN_POOL_PER_HOST,
+		    	    double idleTimeout = JSN_POOL_IDLE_TIMEOUT,
+			    double timeout = 0.0);
+
+	    JSNSockTCPPool (const JSNSockTCPPool &)			= delete;
+	    auto operator= (const JSNSockTCPPool &)			-> JSNSockTCPPool & = delete;
+
+	    /* An idle, healthy connection or a new one; waits (up to	*/
+	    /* 'timeout', zero: forever) while the endpoint is at its cap.	*/
+	    auto acquire (const std::string &host, uint16_t port)	-> lease;
+
+	    /* Open connections ahead of demand, up to 'count' idle ones */
+	    auto warm (const std::string &host, uint16_t port,
+		    				uint32_t count)		-> void;
+
+	    /* Close idle connections that expired or went dead */
+	    auto purge ()						-> void;
+
+	    auto idle (const std::string &host, uint16_t port)		-> size_t;
+
+	    /* Idle connection check: no pending data, no hangup, no error */
+	    static auto alive (JSNSockTCP &socket)			-> bool;
+    }; /* JSNSockTCPPool */
+} /* namespace jsnSock */
+#endif
@@ -0,0 +1,119 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+#ifndef _JSNSockReactor_HPP_
+#define _JSNSockReactor_HPP_
+#define JSN_REACTOR_EVENTS 256
+
+/* Includes */
+#include <sys/epoll.h>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "JSNException.hpp"
+
+/* Interface Declaration */
+namespace jsnSock
+{
+    /* JSNSockReactor
+     * An edge-triggered epoll event loop.  Any number of descriptors are
+     * registered with a callback; a single thread calling 'run' (or 'poll')
+     * dispatches their readiness events.  Because registration is
+     * edge-triggered, a callback must drain its descriptor (read or write
+     * until EAGAIN) before returning or it will not be woken again.
+     */
+    class JSNSockReactor
+    {
+	public:
+	    enum event : uint32_t	/* uses <sys/epoll.h> */
+	    {
+		readable	= EPOLLIN,
+		writable	= EPOLLOUT,
+		hangup		= EPOLLRDHUP | EPOLLHUP,
+		error		= EPOLLERR
+	    };
+
+	    typedef std::function<void (uint32_t events)>	callback;
+
+	private:
+	    /* One heap-allocated record per registered descriptor, and one	*/
+	    /* per watcher of it.  The kernel hands the descriptor's pointer	*/
+	    /* back in 'epoll_event.data', so a descriptor removed (and	*/
+	    /* possibly re-used) while a batch is being dispatched is		*/
+	    /* recognised by its 'live' flag.					*/
+	    struct registration
+	    {
+		int				fd;
+		bool				live;
+		callback			handler;	/* empty while only watched */
+		uint32_t			events;		/* the handler's own interest */
+		registration			*owner;		/* a watcher's descriptor */
+		uint64_t			token;		/* a watcher's, for 'unwatch' */
+		std::vector<registration *>	watchers;
+	    };
+
+	    int					epollDesc;
+	    int					wakeDesc;	/* eventfd used by 'stop' */
+	    std::atomic<bool>			stopped;
+	    std::vector<struct epoll_event>	events;
+	    std::unordered_map<int, registration *>	registry;
+	    std::unordered_map<uint64_t, registration *>	watching;	/* by token */
+	    uint64_t				nextToken;
+	    std::vector<registration *>		retired;	/* freed after each batch */
+
+	    auto reap ()						-> void;
+
+	    /* Re-arm 'r' with its handler's and its watchers' interest */
+	    auto update (registration *r)				-> int;
+
+	public:
+	    JSNSockReactor (uint32_t maxEvents = JSN_REACTOR_EVENTS);
+	    ~JSNSockReactor ();
+
+	    JSNSockReactor (const JSNSockReactor &)			= delete;
+	    auto operator= (const JSNSockReactor &)			-> JSNSockReactor & = delete;
+
+	    /* Registration; 'events' is a mask of the 'event' enum */
+	    auto add (int fd, uint32_t events, callback handler)	-> void;
+	    auto modify (int fd, uint32_t events)			-> void;
+	    auto remove (int fd)					-> void;
+
+	    /* A second party's interest in a descriptor, registered or not:	*/
+	    /* 'events' are merged into its registration and 'handler' runs	*/
+	    /* after the owner's.  'remove' drops the watchers with the	*/
+	    /* descriptor; 'unwatch' a token that is gone does nothing.	*/
+	    auto watch (int fd, uint32_t events, callback handler)	-> uint64_t;
+	    auto unwatch (uint64_t token)				-> void;
+
+	    /* Dispatch one batch of events; 'timeout' in milliseconds, -1 blocks */
+	    auto poll (int timeout = -1)				-> uint32_t;
+
+	    /* Dispatch until 'stop' is called (from any thread, even before 'run') */
+	    auto run ()							-> void;
+	    auto stop ()						-> void;
+
+	    auto size ()						-> size_t
+	    { return registry.size(); }
+    }; /* JSNSockReactor */
+} /* namespace jsnSock */
+#endif
@@ -0,0 +1,139 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+
+#ifndef _JSNSockResolver_HPP_
+#define _JSNSockResolver_HPP_
+#define JSN_RESOLVER_TTL 60.0		/* seconds a successful lookup is reused */
+#define JSN_RESOLVER_NEGATIVE_TTL 5.0	/* seconds a failed lookup is reused */
+#define JSN_RESOLVER_CACHE_MAX 4096	/* expired entries are purged beyond this */
+
+/* Includes */
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "JSNException.hpp"
+
+/* Interface Declaration */
+namespace jsnSock
+{
+    /* JSNSockAddress
+     * One resolved address of any family (port left at zero).
+     */
+    struct JSNSockAddress
+    {
+	struct sockaddr_storage	storage;
+	socklen_t		length;
+
+	auto family () const					-> int
+	{ return storage.ss_family; }
+	auto sockaddr () const					-> const struct ::sockaddr *
+	{ return reinterpret_cast<const struct ::sockaddr *>(&storage); }
+
+	auto port () const					-> uint16_t;
+	auto setPort (uint16_t port)				-> void;
+	auto str () const					-> std::string;	/* numeric form */
+    }; /* JSNSockAddress */
+
+
+
+    /* JSNSockResolver
+     * Hostname resolution via getaddrinfo(3) on a worker thread, with an
+     * in-process cache: successful lookups are reused for 'ttl' seconds,
+     * failures for 'negativeTtl'.  Concurrent requests for a name being
+     * resolved wait on the one lookup in flight, and numeric addresses
+     * never leave the calling thread.
+     */
+    class JSNSockResolver
+    {
+	public:
+	    typedef std::vector<JSNSockAddress>				addresses;
+
+	    /* 'error' is an errno value (zero on success) */
+	    typedef std::function<void (const addresses &result, int error)>	callback;
+
+	private:
+	    typedef std::chrono::steady_clock	clock;
+
+	    struct entry
+	    {
+		addresses		result;
+		int			error		= 0;
+		clock::time_point	expiry;		/* epoch: never resolved */
+		bool			resolving	= false;
+		std::vector<callback>	waiters;
+	    };
+
+	    std::mutex					lock;
+	    std::condition_variable			ready;
+	    std::unordered_map<std::string, entry>	cache;	/* keyed by family + name */
+	    std::deque<std::pair<std::string, int>>	queue;	/* names awaiting the worker */
+	    std::thread					worker;
+	    bool					stopping;
+	    clock::duration				ttl;
+	    clock::duration				negativeTtl;
+
+	    auto work ()						-> void;
+	    auto purge (clock::time_point now)				-> void;
+	    static auto numeric (const std::string &host, int family,
+		    			addresses &result)		-> bool;
+	    static auto lookup (const std::string &host, int family,
+		    			addresses &result)		-> int;
+
+	public:
+	    JSNSockResolver (double ttl = JSN_RESOLVER_TTL,
+		    	     double negativeTtl = JSN_RESOLVER_NEGATIVE_TTL);
+	    ~JSNSockResolver ();
+
+	    JSNSockResolver (const JSNSockResolver &)			= delete;
+	    auto operator= (const JSNSockResolver &)			-> JSNSockResolver & = delete;
+
+	    /* The process-wide resolver used by connect and bind */
+	    static auto shared ()					-> JSNSockResolver &;
+
+	    /* Blocking: served from the cache, or waits up to 'timeout'	*/
+	    /* seconds (zero: no limit) for the worker.  Throws on failure.	*/
+	    auto resolve (const std::string &host, int family = AF_UNSPEC,
+		    			double timeout = 0.0)		-> addresses;
+
+	    /* Non-blocking: 'done' runs at once on a cache hit, otherwise	*/
+	    /* on the worker thread once the lookup completes.			*/
+	    auto resolveAsync (const std::string &host, int family,
+		    			callback done)			-> void;
+
+	    /* Cache only; never touches DNS */
+	    auto cached (const std::string &host, int family,
+		    			addresses &result)		-> bool;
+
+	    auto setTTL (double ttl, double negativeTtl)		-> void;
+	    auto flush ()						-> void;
+    }; /* JSNSockResolver */
+} /* namespace jsnSock */
+#endif
@@ -0,0 +1,174 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+#ifndef _JSNSockRing_HPP_
+#define _JSNSockRing_HPP_
+#define JSN_RING_ENTRIES 256		/* submission queue slots */
+#define JSN_RING_BUFFERS 512		/* provided receive buffers (a power of two) */
+#define JSN_RING_BUFFER_SIZE 4096	/* bytes per provided receive buffer */
+#define JSN_RING_ACCEPT_BACKOFF 100	/* ms before re-arming an accept ended by EMFILE, ENFILE or ENOMEM */
+
+/* Includes */
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "JSNException.hpp"
+#include "JSNSockBuffer.hpp"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+/* Interface Declaration */
+namespace jsnSock
+{
+    /* JSNSockRing
+     * A completion-based event loop on io_uring, the alternative to
+     * JSNSockReactor.  Operations are queued as submission entries and sent
+     * to the kernel together, in the same io_uring_enter(2) that waits for
+     * completions; completions are then reaped from shared memory without
+     * further system calls.  Accepts and receives are multishot: one
+     * submission keeps producing completions, and received data lands in a
+     * ring of provided buffers, so no buffer is tied up by an idle
+     * connection (kernels without buffer rings are handed the same
+     * buffers with IORING_OP_PROVIDE_BUFFERS).  Needs Linux 6.0 or later;
+     * see 'available'.
+     */
+    class JSNSockRing
+    {
+	public:
+	    /* accept: the new descriptor; send: bytes sent.  -errno on failure */
+	    typedef std::function<void (int result)>			completion;
+
+	    /* Each chunk received; an empty view with 'error' zero is the	*/
+	    /* end of the stream.  'data' is only valid during the call.	*/
+	    typedef std::function<void (JSNSockView data, int error)>	receiver;
+
+	private:
+	    enum kind : uint8_t { acceptor, reader, writer, waker };
+
+	    /* One heap-allocated record per operation; its address is the	*/
+	    /* submission's 'user_data'.  A cancelled record stays until the	*/
+	    /* kernel posts its final completion, but its handler is not	*/
+	    /* called again.							*/
+	    struct operation
+	    {
+		kind		type;
+		int		fd;
+		bool		live;
+		completion	done;
+		receiver	data;
+		std::string	output;		/* writer: owned bytes, and ... */
+		size_t		sent;		/* ... how many have gone */
+	    };
+
+	    int					ringDesc;
+	    int					wakeDesc;	/* eventfd used by 'stop' */
+	    std::atomic<bool>			stopped;
+
+	    /* Queues shared with the kernel */
+	    void				*sqMap;
+	    size_t				sqMapSize;
+	    void				*cqMap;
+	    size_t				cqMapSize;
+	    struct io_uring_sqe			*sqes;
+	    size_t				sqesSize;
+	    unsigned				*sqHead, *sqTail, *sqArray;
+	    unsigned				sqMask, sqEntries;
+	    unsigned				*cqHead, *cqTail;
+	    unsigned				cqMask;
+	    struct io_uring_cqe			*cqes;
+	    unsigned				queued;		/* prepared, not yet submitted */
+
+	    /* Provided receive buffers (buffer group 0) */
+	    struct io_uring_buf_ring		*bufRing;
+	    size_t				bufRingSize;
+	    std::vector<char>			bufMemory;
+	    uint32_t				bufCount;
+	    uint32_t				bufSize;
+	    uint16_t				bufTail;
+	    bool				mapped;		/* false: IORING_OP_PROVIDE_BUFFERS instead */
+
+	    operation				wake;
+	    std::unordered_multimap<int, operation *>	operations;
+	    std::vector<operation *>		retired;	/* freed once queued cancels are submitted */
+
+	    auto setup (uint32_t entries, uint32_t flags)		-> void;
+	    auto acquire ()						-> struct io_uring_sqe *;
+	    auto commit ()						-> void;
+	    auto enter (unsigned submit, unsigned wait, int timeout)	-> void;
+	    auto arm (operation *op)					-> void;
+	    auto pause (operation *op)					-> void;
+	    auto mapBuffers ()						-> bool;
+	    auto recycle (uint16_t bid)					-> void;
+	    auto release (operation *op)				-> void;
+	    auto reap (size_t count)					-> void;
+	    auto complete (const struct io_uring_cqe &cqe)		-> bool;
+	    auto teardown ()						-> void;
+
+	public:
+	    JSNSockRing (uint32_t entries = JSN_RING_ENTRIES,
+		    	 uint32_t buffers = JSN_RING_BUFFERS,
+		    	 uint32_t bufferSize = JSN_RING_BUFFER_SIZE);
+	    ~JSNSockRing ();
+
+	    JSNSockRing (const JSNSockRing &)				= delete;
+	    auto operator= (const JSNSockRing &)			-> JSNSockRing & = delete;
+
+	    /* Whether this kernel (and any seccomp policy) allows a ring	*/
+	    /* with provided buffers, supports every opcode used here, and	*/
+	    /* is 6.0 or later for multishot receive; checked once per	*/
+	    /* process.  JSNSockTCPShardedServer falls back to epoll if not.	*/
+	    static auto available ()					-> bool;
+
+	    /* Multishot accept on a listening descriptor; new descriptors	*/
+	    /* are non-blocking and close-on-exec.				*/
+	    auto accept (int listenDesc, completion handler)		-> void;
+
+	    /* Multishot receive into the provided buffers */
+	    auto recv (int fd, receiver handler)			-> void;
+
+	    /* Send all of 'data', resubmitting after short sends; 'handler'	*/
+	    /* (optional) gets the total or the first error.			*/
+	    auto send (int fd, std::string data,
+		    		completion handler = nullptr)		-> void;
+
+	    /* Cancel every operation on 'fd'; safe whether or not 'fd' has	*/
+	    /* already been closed.  Their handlers are not called again.	*/
+	    auto cancel (int fd)					-> void;
+
+	    /* Submit what is queued and dispatch one batch of completions;	*/
+	    /* 'timeout' in milliseconds, -1 blocks.				*/
+	    auto poll (int timeout = -1)				-> uint32_t;
+
+	    /* Dispatch until 'stop' is called (from any thread, even before 'run') */
+	    auto run ()							-> void;
+	    auto stop ()						-> void;
+
+	    auto size ()						-> size_t
+	    { return operations.size(); }
+    }; /* JSNSockRing */
+} /* namespace jsnSock */
+#endif
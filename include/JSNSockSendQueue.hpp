@@ -0,0 +1,106 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+#ifndef _JSNSockSendQueue_HPP_
+#define _JSNSockSendQueue_HPP_
+
+/* Includes */
+#include "JSNSock.hpp"
+#include <atomic>
+
+/* Interface Declaration */
+namespace jsnSock
+{
+    /* JSNSockSendQueue
+     * Outbound data for one connection, written by any number of threads
+     * and sent by one.  'push' never blocks or locks: it links a node onto
+     * a lock-free stack and, when the stack was empty, wakes the owner
+     * through an eventfd.  The owning I/O thread's 'drain' takes the whole
+     * stack with one exchange and writes it in order with as few
+     * sendmsg(2) calls as the kernel allows.  Each producer's messages go
+     * out in the order it pushed them.  The socket must outlive the queue
+     * and must only be written through it while the queue is in use.
+     */
+    class JSNSockSendQueue
+    {
+	private:
+	    struct node
+	    {
+		std::string	data;
+		node		*next;
+	    };
+
+	    JSNSockTCP			&socket;
+	    int				wakeDesc;	/* eventfd, readable after a push to an empty queue */
+	    uint64_t			watchToken = 0;	/* 'attach' watches the socket for writability */
+	    JSNSockReactor		*reactor = nullptr;
+	    int				failure = 0;	/* errno of a send that failed under 'attach' */
+	    std::atomic<node *>		top;		/* producers: newest first */
+
+	    /* Owning thread only: taken from 'top', oldest first */
+	    std::deque<std::string>	unsent;
+	    size_t			offset = 0;	/* bytes of unsent.front() already sent */
+
+	    auto take ()						-> void;
+
+	    /* 'drain' from a reactor callback: a failed send is logged, the	*/
+	    /* queue detached and emptied and the connection shut down,	*/
+	    /* instead of the exception ending the reactor's loop.		*/
+	    auto pump ()						-> void;
+	    auto detach ()						-> void;
+
+	public:
+	    JSNSockSendQueue (JSNSockTCP &socket);
+	    ~JSNSockSendQueue ();
+
+	    JSNSockSendQueue (const JSNSockSendQueue &)			= delete;
+	    auto operator= (const JSNSockSendQueue &)			-> JSNSockSendQueue & = delete;
+
+	    /* Any thread */
+	    auto push (std::string data)				-> void;
+	    auto push (const void *buffer, size_t size)			-> void
+	    { push(std::string(static_cast<const char *>(buffer), size)); }
+
+	    /* Owning thread.  'drain' sends what it can without blocking and	*/
+	    /* keeps the rest; call it again when the socket turns writable.	*/
+	    /* It returns the number of bytes sent.				*/
+	    auto drain ()						-> size_t;
+	    auto empty () const						-> bool
+	    { return unsent.empty() && top.load(std::memory_order_acquire) == nullptr; }
+
+	    /* Readable once pushes are waiting; or let 'attach' register it	*/
+	    /* with the owning thread's reactor, which then drains on wake-up	*/
+	    /* and whenever the socket turns writable with data left over.	*/
+	    /* Writability is watched through the socket's own registration	*/
+	    /* (its owner may add it before or after), so removing the socket	*/
+	    /* from the reactor ends the watch too.  Otherwise destroy the	*/
+	    /* queue before the socket is closed.				*/
+	    auto descriptor () const					-> int
+	    { return wakeDesc; }
+	    auto attach (JSNSockReactor &reactor)			-> void;
+
+	    /* Non-zero (an errno value) once a send failed under 'attach' */
+	    auto failed () const					-> int
+	    { return failure; }
+    }; /* JSNSockSendQueue */
+} /* namespace jsnSock */
+#endif
@@ -23,14 +23,19 @@
 /* Includes */
 #include "JSNSock.hpp"
 #include <fcntl.h>	/* used for the 'fcntl' method and associated constants */
-#include <netdb.h>	/* used for the 'hostent' struct in 'getHostBy...' methods */
+#include <netdb.h>	/* used for 'getnameinfo' in 'getHostByAddr' */
+#include <limits.h>	/* used for 'INT_MAX' */
+#include <poll.h>	/* used for the 'wait' method */
 #include <unistd.h>	/* used for the 'close(2)' method */
+#include <string.h>	/* used for 'memset' */
 
 /* Using */
 using std::string;
 using namespace jsnSock;
 
 /* Implementation */
+const int JSNSockBase::invalid;
+
 JSNSockBase::JSNSockBase(
 	uint32_t	domain,
 	uint32_t	type,
@@ -44,7 +49,8 @@ JSNSockBase::JSNSockBase(
     this->protocol	= protocol;
     this->timeout	= timeout;
 
-    sockDesc = socket(domain, type, protocol);
+    /* a timed socket is created non-blocking and stays that way */
+    sockDesc = socket(domain, type | (timeout != 0.0 ? SOCK_NONBLOCK : 0), protocol);
     if (sockDesc == -1) // something went wrong, throw an error.
 	throw JSNException("Unable to create a base socket descriptor.");
 } /* JSNSockBase constructor 1/1 */
@@ -54,10 +60,68 @@ JSNSockBase::~JSNSockBase()
     close();
 }
 
+JSNSockBase::JSNSockBase(
+	JSNSockBase	&&other
+	) noexcept
+: sockDesc(other.sockDesc), domain(other.domain), type(other.type),
+  protocol(other.protocol), timeout(other.timeout), counters(other.counters)
+{
+    socketInfoArray[0]	= std::move(other.socketInfoArray[0]);
+    socketInfoArray[1]	= std::move(other.socketInfoArray[1]);
+    other.sockDesc	= invalid;
+}
+
+auto JSNSockBase::operator=(
+	JSNSockBase	&&other
+	) noexcept	-> JSNSockBase &
+{
+    if (this != &other)
+    {
+	if (sockDesc != invalid)
+	    ::close(sockDesc);
+
+	sockDesc		= other.sockDesc;
+	domain			= other.domain;
+	type			= other.type;
+	protocol		= other.protocol;
+	timeout			= other.timeout;
+	counters		= other.counters;
+	socketInfoArray[0]	= std::move(other.socketInfoArray[0]);
+	socketInfoArray[1]	= std::move(other.socketInfoArray[1]);
+	other.sockDesc		= invalid;
+    }
+
+    return *this;
+}
+
 auto JSNSockBase::close (
 	)		-> void
 {
-    ::close(sockDesc);
+    if (sockDesc != invalid)
+    {
+	::close(sockDesc);
+	sockDesc = invalid;
+    }
+}
+
+auto JSNSockBase::release (
+	)		-> int
+{
+    int		fd = sockDesc;
+
+    sockDesc = invalid;
+    return fd;
+}
+
+auto JSNSockBase::adopt (
+	int		fd
+	)		-> void
+{
+    if (fd == sockDesc)
+	return;
+
+    close();
+    sockDesc = fd;
 }
 
 auto JSNSockBase::sockOption(
@@ -87,9 +151,87 @@ auto JSNSockBase::setTimeout(
 	double		timeout
 	)		-> void
 {
+    /* only touch the descriptor when switching between timed and untimed */
+    if ( sockDesc != invalid && (timeout == 0.0) != (this->timeout == 0.0) )
+	setBlocking(timeout == 0.0);
+
     this->timeout = timeout;
 }
 
+auto JSNSockBase::deadline(
+	)		-> clock::time_point
+{
+    if (timeout == 0.0)
+	return clock::time_point::max();
+
+    return clock::now() + std::chrono::duration_cast<clock::duration>(
+	    std::chrono::duration<double>(timeout));
+}
+
+auto JSNSockBase::wait(
+	short				events,
+	clock::time_point		limit,
+	JSNSockMetrics::histogram	timing
+	)				-> void
+{
+    if ( (errno = waitFor(events, limit, timing)) == ETIMEDOUT )
+	throw JSNException("JSNSockBase: operation timed-out.");
+    else if (errno != 0)
+	throw JSNException("JSNSockBase: poll exception; check file descriptors.");
+    /* ready (or POLLERR/POLLHUP): the caller's retry reports any error */
+}
+
+auto JSNSockBase::waitFor(
+	short				events,
+	clock::time_point		limit,
+	JSNSockMetrics::histogram	timing
+	)				-> int
+{
+    return waitFor(sockDesc, events, limit, timing);
+}
+
+auto JSNSockBase::waitFor(
+	int				fd,
+	short				events,
+	clock::time_point		limit,
+	JSNSockMetrics::histogram	timing
+	)				-> int
+{
+    struct pollfd	pfd;
+    int			ready;
+    int			remaining;
+    bool		timed = timing != JSNSockMetrics::histograms && JSNSockMetrics::enabled();
+    clock::time_point	started = timed ? clock::now() : clock::time_point();
+
+    pfd.fd	= fd;
+    pfd.events	= events;
+
+    do
+    {
+	if (limit == clock::time_point::max())
+	    remaining = -1;
+	else
+	{
+	    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+		    limit - clock::now() + std::chrono::microseconds(999)); /* round up */
+	    remaining = left.count() <= 0 ? 0 : (left.count() > INT_MAX ? INT_MAX : left.count());
+	}
+
+	ready = ::poll(&pfd, 1, remaining);
+    } while (ready == -1 && errno == EINTR);
+
+    if (timed)
+	JSNSockMetrics::record(timing, std::chrono::duration_cast<std::chrono::nanoseconds>(
+		    clock::now() - started).count());
+
+    if (ready == -1)
+	return errno;
+    else if (ready == 0)
+	return ETIMEDOUT;
+
+    return 0;
+} /* JSNSockBase::waitFor (int, short, clock::time_point, histogram) */
+
 auto JSNSockBase::ntoa(
 	in_addr_t	addr
 	)		-> string
@@ -108,36 +250,24 @@ auto JSNSockBase::ntoa(
 auto JSNSockBase::socketInfo(
 	)			-> void
 {
-    std::string		address_str;
-    uint16_t		port_num;
-    struct sockaddr_in	sockAddr;
-    socklen_t		len;
-    int8_t		resultCode;
-
-    len = sizeof(struct sockaddr_in);
+    JSNSockAddress	sockAddr;
 
-    /* clear the contents of the sockaddr_in struct */
-    bzero((char *) &sockAddr, sizeof(sockAddr));
+    /* sockaddr_storage holds either family */
+    memset(&sockAddr, 0, sizeof(sockAddr));
+    sockAddr.length = sizeof(sockAddr.storage);
 
-    if (getpeername(sockDesc, (struct sockaddr *) &sockAddr, &len) == -1)
+    if (getpeername(sockDesc, (struct sockaddr *) &sockAddr.storage, &sockAddr.length) == -1)
 	throw JSNException("JSNSockBase: socketInfo (peer name) exception.");
     else
-    {
-	address_str = ntoa(sockAddr.sin_addr.s_addr);
-	port_num = htons(sockAddr.sin_port);
-	socketInfoArray[0] = std::make_pair(address_str, port_num);
-    }
+	socketInfoArray[0] = std::make_pair(sockAddr.str(), sockAddr.port());
 
-    bzero((char *) &sockAddr, sizeof(sockAddr));
+    memset(&sockAddr, 0, sizeof(sockAddr));
+    sockAddr.length = sizeof(sockAddr.storage);
 
-    if (getsockname(sockDesc, (struct sockaddr *) &sockAddr, &len) == -1)
+    if (getsockname(sockDesc, (struct sockaddr *) &sockAddr.storage, &sockAddr.length) == -1)
 	throw JSNException("JSNSockBase: socketInfo (sock name) exception.");
     else
-    {
-	address_str = ntoa(sockAddr.sin_addr.s_addr);
-	port_num = htons(sockAddr.sin_port);
-	socketInfoArray[1] = std::make_pair(address_str, port_num);
-    }
+	socketInfoArray[1] = std::make_pair(sockAddr.str(), sockAddr.port());
 }
 
 auto JSNSockBase::isBlocking(
@@ -150,7 +280,7 @@ auto JSNSockBase::isBlocking(
 	throw JSNException("Unable to obtain socket blocking flags (via fcntl).");
     }
 
-    return ((flags & O_NONBLOCK) ? true : false);
+    return ((flags & O_NONBLOCK) ? false : true);
 }
 
 auto JSNSockBase::setBlocking(
@@ -184,33 +314,36 @@ auto JSNSockBase::getHostByName(
 	const string		&name
 	)			-> string
 {
-    const std::unique_ptr<char> response(new char[ADDR_STR_LEN]); /* RAII; anti-exploit measure */
-    struct hostent		*host;
+    JSNSockResolver::addresses	result;
 
-    if ( (host = gethostbyname(name.c_str())) )	/* gethostbyname returns a NULL ptr on error */
+    if (name.empty())
+	return string();
+
+    try
+    {
+	result = JSNSockResolver::shared().resolve(name, AF_INET, timeout);
+    }
+    catch (JSNException &e)
     {
-	snprintf (response.get(), ADDR_STR_LEN, "%u.%u.%u.%u",
-		(unsigned char) host->h_addr[0],
-		(unsigned char) host->h_addr[1],
-		(unsigned char) host->h_addr[2],
-		(unsigned char) host->h_addr[3]
-		);
+	return string();
     }
 
-    return string(response.get());
+    return result.front().str();
 }
 
 auto JSNSockBase::getHostByAddr(
 	const string	&addr
 	)		-> string
 {
-    struct in_addr	*intAddr;
-    struct hostent	*host;
+    JSNSockResolver::addresses	result;
+    char			host[NI_MAXHOST] = "";
 
-    if ( inet_aton(addr.c_str(), intAddr) != 0 ) /* inet_aton does format sanity check */
+    /* a numeric address resolves without any lookup */
+    if ( JSNSockResolver::shared().cached(addr, AF_UNSPEC, result) )
     {
-	host = gethostbyaddr(&intAddr->s_addr, 4, AF_INET);
+	getnameinfo(result.front().sockaddr(), result.front().length,
+		host, sizeof(host), nullptr, 0, NI_NAMEREQD);
     }
 
-    return string(host->h_name); /* may be empty */
+    return string(host); /* may be empty */
 }
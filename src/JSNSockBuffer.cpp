@@ -0,0 +1,243 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+
+/* Includes */
+#include "JSNSockBuffer.hpp"
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+const size_t JSNSockBuffer::npos;
+
+JSNSockBuffer::JSNSockBuffer(
+	size_t		capacity
+	)
+: limit(capacity ? capacity : 1), head(0), tail(0)
+{
+}
+
+JSNSockBuffer::JSNSockBuffer(
+	JSNSockBuffer	&&other
+	) noexcept
+: storage(std::move(other.storage)), limit(other.limit), head(other.head), tail(other.tail)
+{
+    other.storage.clear();
+    other.head = other.tail = 0;
+}
+
+auto JSNSockBuffer::operator=(
+	JSNSockBuffer	&&other
+	) noexcept	-> JSNSockBuffer &
+{
+    if (this != &other)
+    {
+	storage	= std::move(other.storage);
+	limit	= other.limit;
+	head	= other.head;
+	tail	= other.tail;
+
+	other.storage.clear();
+	other.head = other.tail = 0;
+    }
+
+    return *this;
+}
+
+auto JSNSockBuffer::consume(
+	size_t		n
+	)		-> void
+{
+    if (n >= size())
+	head = tail = 0;	/* empty: the next fill starts at the front */
+    else
+	head += n;
+}
+
+auto JSNSockBuffer::space(
+	)		-> char *
+{
+    if (storage.empty())
+	storage.resize(limit);
+
+    if (tail == storage.size() && head != 0)	/* out of room: slide unread bytes down */
+    {
+	memmove(storage.data(), storage.data() + head, tail - head);
+	tail -= head;
+	head = 0;
+    }
+
+    return storage.data() + tail;
+}
+
+auto JSNSockBuffer::reserve(
+	size_t		n
+	)		-> void
+{
+    space();
+    if (spaceSize() >= n)
+	return;
+
+    if (head != 0)
+    {
+	memmove(storage.data(), storage.data() + head, tail - head);
+	tail -= head;
+	head = 0;
+    }
+
+    if (spaceSize() < n)
+	storage.resize(tail + n);
+}
+
+auto JSNSockBuffer::resize(
+	size_t		capacity
+	)		-> void
+{
+    if (capacity < size())
+	capacity = size();
+    if (capacity == 0)
+	capacity = 1;
+
+    if (storage.empty())
+    {
+	limit = capacity;
+	return;
+    }
+
+    if (head != 0)
+    {
+	memmove(storage.data(), storage.data() + head, tail - head);
+	tail -= head;
+	head = 0;
+    }
+    storage.resize(capacity);
+    storage.shrink_to_fit();
+    limit = capacity;
+}
+
+
+
+/* JSNSockLease */
+JSNSockLease::~JSNSockLease()
+{
+    if (block)
+	JSNSockBufferPool::local().give(block, sizeClass);
+}
+
+JSNSockLease::JSNSockLease(
+	JSNSockLease	&&other
+	) noexcept
+: block(other.block), blockSize(other.blockSize), length(other.length), sizeClass(other.sizeClass)
+{
+    other.block		= nullptr;
+    other.blockSize	= other.length = 0;
+}
+
+auto JSNSockLease::operator=(
+	JSNSockLease	&&other
+	) noexcept	-> JSNSockLease &
+{
+    if (this != &other)
+    {
+	if (block)
+	    JSNSockBufferPool::local().give(block, sizeClass);
+
+	block		= other.block;
+	blockSize	= other.blockSize;
+	length		= other.length;
+	sizeClass	= other.sizeClass;
+
+	other.block	= nullptr;
+	other.blockSize	= other.length = 0;
+    }
+
+    return *this;
+}
+
+
+/* JSNSockBufferPool */
+const size_t JSNSockBufferPool::smallest;
+const size_t JSNSockBufferPool::largest;
+
+JSNSockBufferPool::~JSNSockBufferPool()
+{
+    for (auto &list : freeList)
+	for (char *block : list)
+	    delete [] block;
+}
+
+auto JSNSockBufferPool::local(
+	)		-> JSNSockBufferPool &
+{
+    static thread_local JSNSockBufferPool	pool;
+    return pool;
+}
+
+auto JSNSockBufferPool::lease(
+	size_t		size
+	)		-> JSNSockLease
+{
+    return local().take(size);
+}
+
+auto JSNSockBufferPool::take(
+	size_t		size
+	)		-> JSNSockLease
+{
+    if (size > largest)	/* oversize: not pooled */
+	return JSNSockLease(new char[size], size, JSN_POOL_CLASSES);
+
+    uint32_t	sizeClass = 0;
+    size_t	blockSize = smallest;
+
+    while (blockSize < size)
+    {
+	blockSize <<= 1;
+	sizeClass++;
+    }
+
+    std::vector<char *>	&list = freeList[sizeClass];
+    if (list.empty())
+	return JSNSockLease(new char[blockSize], blockSize, sizeClass);
+
+    char	*block = list.back();
+    list.pop_back();
+
+    return JSNSockLease(block, blockSize, sizeClass);
+}
+
+auto JSNSockBufferPool::give(
+	char		*block,
+	uint32_t	sizeClass
+	)		-> void
+{
+    if (sizeClass >= JSN_POOL_CLASSES || freeList[sizeClass].size() >= JSN_POOL_KEEP)
+    {
+	delete [] block;
+	return;
+    }
+
+    if (freeList[sizeClass].capacity() == 0)
+	freeList[sizeClass].reserve(JSN_POOL_KEEP);	/* never reallocates afterwards */
+    freeList[sizeClass].push_back(block);
+}
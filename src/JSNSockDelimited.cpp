@@ -0,0 +1,449 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+
+/* Includes */
+#include "JSNSockDelimited.hpp"
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+#if !defined(JSN_NO_SIMD) && defined(__GNUC__) && defined(__SSE2__) && \
+	(defined(__x86_64__) || defined(__i386__))
+#define JSN_SCAN_X86
+#include <immintrin.h>	/* SSE2 always; AVX2 only in functions built for it */
+#endif
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+namespace
+{
+    /* Offsets of up to 'most' non-overlapping matches of the delimiter	*/
+    /* in 'data', in order, stored in 'found'; returns their number.	*/
+    typedef size_t (*kernel)(const char *data, size_t size,
+	    const char *delimiter, size_t length, size_t *found, size_t most);
+
+    auto scanScalar (
+	    const char	*data,
+	    size_t	size,
+	    const char	*delimiter,
+	    size_t	length,
+	    size_t	*found,
+	    size_t	most
+	    )		-> size_t
+    {
+	size_t	n = 0;
+	size_t	at = 0;
+
+	while (n < most && at + length <= size)
+	{
+	    const void	*hit = memchr(data + at, delimiter[0], size - length + 1 - at);
+
+	    if (!hit)
+		break;
+
+	    at = static_cast<const char *>(hit) - data;
+	    if (memcmp(data + at + 1, delimiter + 1, length - 1) == 0)
+	    {
+		found[n++] = at;
+		at += length;
+	    }
+	    else
+		at++;
+	}
+
+	return n;
+    } /* scanScalar */
+
+#ifdef JSN_SCAN_X86
+    /* The candidates in one block ('mask' bit i: a start at 'at' + i),	*/
+    /* confirmed and recorded; false once 'most' matches are found.	*/
+    inline auto confirm (
+	    const char	*data,
+	    size_t	at,
+	    uint32_t	mask,
+	    const char	*delimiter,
+	    size_t	length,
+	    size_t	*found,
+	    size_t	most,
+	    size_t	&n,
+	    size_t	&next		/* earliest start that overlaps no match */
+	    )		-> bool
+    {
+	while (mask)
+	{
+	    size_t	candidate = at + __builtin_ctz(mask);
+
+	    mask &= mask - 1;
+	    if (candidate >= next &&	/* first and last bytes already match */
+		    (length <= 2 || memcmp(data + candidate + 1, delimiter + 1, length - 2) == 0))
+	    {
+		found[n++]	= candidate;
+		next		= candidate + length;
+		if (n == most)
+		    return false;
+	    }
+	}
+
+	return true;
+    } /* confirm */
+
+    /* Starts too close to the end for a whole block */
+    inline auto finish (
+	    const char	*data,
+	    size_t	size,
+	    size_t	at,
+	    const char	*delimiter,
+	    size_t	length,
+	    size_t	*found,
+	    size_t	most,
+	    size_t	n
+	    )		-> size_t
+    {
+	size_t	more = scanScalar(data + at, size - at, delimiter, length, found + n, most - n);
+
+	for (size_t i = n; i < n + more; i++)
+	    found[i] += at;
+
+	return n + more;
+    } /* finish */
+
+    auto scanSSE2 (
+	    const char	*data,
+	    size_t	size,
+	    const char	*delimiter,
+	    size_t	length,
+	    size_t	*found,
+	    size_t	most
+	    )		-> size_t
+    {
+	const __m128i	first	= _mm_set1_epi8(delimiter[0]);
+	const __m128i	last	= _mm_set1_epi8(delimiter[length - 1]);
+	size_t		n	= 0;
+	size_t		next	= 0;
+	size_t		at	= 0;
+
+	/* 16 starts per step: the block at each start and the block at	*/
+	/* its last delimiter byte, both within 'data'			*/
+	for ( ; at + 16 + length - 1 <= size; at += 16)
+	{
+	    __m128i	head	= _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + at));
+	    __m128i	tail	= _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + at + length - 1));
+	    uint32_t	mask	= _mm_movemask_epi8(
+				    _mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+
+	    if (mask && !confirm(data, at, mask, delimiter, length, found, most, n, next))
+		return n;
+	}
+
+	return finish(data, size, std::max(at, next), delimiter, length, found, most, n);
+    } /* scanSSE2 */
+
+    __attribute__((target("avx2")))
+    auto scanAVX2 (
+	    const char	*data,
+	    size_t	size,
+	    const char	*delimiter,
+	    size_t	length,
+	    size_t	*found,
+	    size_t	most
+	    )		-> size_t
+    {
+	const __m256i	first	= _mm256_set1_epi8(delimiter[0]);
+	const __m256i	last	= _mm256_set1_epi8(delimiter[length - 1]);
+	size_t		n	= 0;
+	size_t		next	= 0;
+	size_t		at	= 0;
+
+	for ( ; at + 32 + length - 1 <= size; at += 32)
+	{
+	    __m256i	head	= _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + at));
+	    __m256i	tail	= _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + at + length - 1));
+	    uint32_t	mask	= _mm256_movemask_epi8(
+				    _mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+
+	    if (mask && !confirm(data, at, mask, delimiter, length, found, most, n, next))
+		return n;
+	}
+
+	return finish(data, size, std::max(at, next), delimiter, length, found, most, n);
+    } /* scanAVX2 */
+#endif
+
+    struct engine
+    {
+	kernel		scan;
+	const char	*name;
+    };
+
+    const engine	scalar = { scanScalar, "scalar" };
+#ifdef JSN_SCAN_X86
+    const engine	sse2 = { scanSSE2, "sse2" };
+    const engine	avx2 = { scanAVX2, "avx2" };
+#endif
+
+    auto choose (
+	    )		-> const engine *
+    {
+#ifdef JSN_SCAN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	    return &avx2;
+	return &sse2;
+#else
+	return &scalar;
+#endif
+    }
+
+    std::atomic<const engine *>	forced { nullptr };	/* set by 'setEngine' */
+
+    auto chosen (
+	    )		-> const engine &
+    {
+	static const engine	*selected = choose();
+	const engine		*preferred = forced.load(std::memory_order_relaxed);
+
+	return preferred ? *preferred : *selected;
+    }
+} /* namespace */
+
+const size_t	JSNSockDelimiter::npos;
+
+JSNSockDelimiter::JSNSockDelimiter(
+	const std::string	&sequence
+	)
+: sequence(sequence)
+{
+    if (sequence.empty())
+    {
+	errno = EINVAL;
+	throw JSNException("JSNSockDelimiter: the delimiter may not be empty.");
+    }
+}
+
+auto JSNSockDelimiter::engine(
+	)		-> const char *
+{
+    return chosen().name;
+}
+
+auto JSNSockDelimiter::setEngine(
+	const std::string	&name
+	)			-> void
+{
+    if (name.empty())
+    {
+	forced.store(nullptr, std::memory_order_relaxed);
+	return;
+    }
+    if (name == scalar.name)
+    {
+	forced.store(&scalar, std::memory_order_relaxed);
+	return;
+    }
+#ifdef JSN_SCAN_X86
+    if (name == sse2.name)
+    {
+	forced.store(&sse2, std::memory_order_relaxed);
+	return;
+    }
+    if (name == avx2.name && choose() == &avx2)	/* the CPU has it */
+    {
+	forced.store(&avx2, std::memory_order_relaxed);
+	return;
+    }
+#endif
+
+    errno = EINVAL;
+    throw JSNException("JSNSockDelimiter: no such scanning kernel in this build or on this CPU.");
+} /* JSNSockDelimiter::setEngine */
+
+auto JSNSockDelimiter::find(
+	const char	*data,
+	size_t		size,
+	size_t		from
+	) const		-> size_t
+{
+    size_t	found;
+
+    if (from + sequence.size() > size)
+	return npos;
+
+    if (chosen().scan(data + from, size - from, sequence.data(), sequence.size(), &found, 1) == 0)
+	return npos;
+    return from + found;
+}
+
+auto JSNSockDelimiter::split(
+	const char			*data,
+	size_t				size,
+	std::vector<JSNSockView>	&tokens,
+	size_t				from
+	) const				-> size_t
+{
+    size_t	found[JSN_SCAN_BATCH];
+    size_t	start = 0;	/* of the current token */
+    size_t	n;
+    kernel	scan = chosen().scan;
+
+    do
+    {
+	if (from + sequence.size() > size)
+	    break;
+
+	n = scan(data + from, size - from, sequence.data(), sequence.size(), found, JSN_SCAN_BATCH);
+	for (size_t i = 0; i < n; i++)
+	{
+	    size_t	at = from + found[i];
+
+	    tokens.push_back(JSNSockView { data + start, at - start });
+	    start = at + sequence.size();
+	}
+	from = std::max(from, start);
+    } while (n == JSN_SCAN_BATCH);
+
+    return start;
+} /* JSNSockDelimiter::split */
+
+
+JSNSockDelimitedChannel::JSNSockDelimitedChannel(
+	JSNSockTCP		&socket,
+	const std::string	&delimiter,
+	size_t			maxLine
+	)
+: socket(socket), delimiter(delimiter), maxLine(maxLine), pending(0), scanned(0)
+{
+}
+
+auto JSNSockDelimitedChannel::release(
+	)		-> void
+{
+    socket.consume(pending);	/* the previous records are released only now */
+    pending = 0;
+}
+
+auto JSNSockDelimitedChannel::check(
+	size_t		length
+	)		-> void
+{
+    if (length > maxLine)
+    {
+	errno = EMSGSIZE;
+	throw JSNException("JSNSockDelimitedChannel: record exceeds the maximum length.");
+    }
+}
+
+auto JSNSockDelimitedChannel::more(
+	)		-> bool
+{
+    size_t	buffered = socket.buffered();
+    size_t	capacity = socket.recvBufferCapacity();
+
+    /* no delimiter starts in the first 'scanned' bytes, so the record	*/
+    /* is longer than that; past 'maxLine' no more reading can help	*/
+    check(scanned);
+
+    /* a long record grows the buffer (up to what 'maxLine' needs) */
+    if (buffered >= capacity)
+	socket.setRecvBufferSize(std::max(capacity + 1, std::min(2 * capacity, maxLine + delimiter.size())));
+
+    return socket.fill() != 0;
+}
+
+auto JSNSockDelimitedChannel::next(
+	JSNSockView	&record
+	)		-> bool
+{
+    release();
+
+    while (1)
+    {
+	JSNSockView	data = socket.buffered() ? socket.peek() : JSNSockView { nullptr, 0 };
+	size_t		at = delimiter.find(data.data, data.size, scanned);
+
+	if (at != JSNSockDelimiter::npos)
+	{
+	    check(at);
+	    record	= JSNSockView { data.data, at };
+	    pending	= at + delimiter.size();
+	    scanned	= 0;
+	    return true;
+	}
+
+	if (data.size >= delimiter.size())
+	    scanned = data.size - delimiter.size() + 1;
+
+	if (!more())
+	{
+	    /* the buffer may have moved while trying to read */
+	    record	= socket.buffered() ? socket.peek() : JSNSockView { nullptr, 0 };
+	    scanned	= 0;
+	    check(record.size);	/* held to the limit like any other record */
+	    pending	= record.size;
+	    return !record.empty();	/* an unterminated last record */
+	}
+    }
+} /* JSNSockDelimitedChannel::next */
+
+auto JSNSockDelimitedChannel::receive(
+	std::vector<JSNSockView>	&records
+	)				-> size_t
+{
+    release();
+    records.clear();
+
+    while (1)
+    {
+	JSNSockView	data = socket.buffered() ? socket.peek() : JSNSockView { nullptr, 0 };
+	size_t		used = delimiter.split(data.data, data.size, records, scanned);
+
+	if (!records.empty())
+	{
+	    for (const JSNSockView &record : records)
+		check(record.size);
+
+	    /* the scan went to the end: nothing after 'used' starts a delimiter */
+	    pending = used;
+	    scanned = (data.size - used >= delimiter.size()) ? data.size - used - delimiter.size() + 1 : 0;
+	    return records.size();
+	}
+
+	if (data.size >= delimiter.size())
+	    scanned = data.size - delimiter.size() + 1;
+
+	if (!more())
+	{
+	    JSNSockView	rest = socket.buffered() ? socket.peek() : JSNSockView { nullptr, 0 };
+
+	    scanned = 0;
+	    if (rest.empty())
+		return 0;
+
+	    check(rest.size);
+	    records.push_back(rest);	/* an unterminated last record */
+	    pending = rest.size;
+	    return 1;
+	}
+    }
+} /* JSNSockDelimitedChannel::receive */
@@ -0,0 +1,217 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+
+/* Includes */
+#include "JSNSockFrame.hpp"
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+JSNSockFramedChannel::JSNSockFramedChannel(
+	JSNSockTCP	&socket,
+	uint32_t	format,
+	size_t		maxFrame
+	)
+: socket(socket), format(format), maxFrame(maxFrame), pending(0)
+{
+}
+
+auto JSNSockFramedChannel::decode(
+	const char	*data,
+	size_t		available,
+	size_t		&header,
+	size_t		&body
+	)		-> bool
+{
+    uint64_t	length = 0;
+
+    header = 0;
+    if (format == fixed32)
+    {
+	if (available < 4)
+	    return false;
+
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+	length = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+	header = 4;
+    }
+    else
+    {
+	size_t	i;
+	for (i = 0; i < available && i < 10; i++)
+	{
+	    length |= uint64_t(data[i] & 0x7f) << (7 * i);
+	    if ( !(data[i] & 0x80) )
+		break;
+	}
+
+	/* Ten bytes carry 70 bits: the tenth must end the prefix (i == 10	*/
+	/* otherwise) and may only hold bit 63 of the length.			*/
+	if (i == 10 || (i == 9 && i < available && (data[9] & 0x7e)))
+	{
+	    errno = EPROTO;
+	    throw JSNException("JSNSockFramedChannel: malformed varint length prefix.");
+	}
+	if (i == available)	/* prefix continues past what has arrived */
+	    return false;
+	header = i + 1;
+    }
+
+    if (length > maxFrame)
+    {
+	errno = EMSGSIZE;
+	throw JSNException("JSNSockFramedChannel: frame exceeds the maximum frame size.");
+    }
+
+    body = length;
+    return available - header >= body;
+} /* JSNSockFramedChannel::decode */
+
+auto JSNSockFramedChannel::more(
+	size_t		needed
+	)		-> bool
+{
+    /* a frame bigger than the buffer grows it; unread bytes are kept */
+    if (needed > socket.recvBufferCapacity())
+	socket.setRecvBufferSize(needed);
+
+    return socket.fill() != 0;
+}
+
+auto JSNSockFramedChannel::send(
+	const void	*frame,
+	size_t		size,
+	bool		more
+	)		-> void
+{
+    unsigned char	prefix[10];
+    struct iovec	iov[2];
+
+    if (size > maxFrame)
+    {
+	errno = EMSGSIZE;
+	throw JSNException("JSNSockFramedChannel: frame exceeds the maximum frame size.");
+    }
+
+    iov[0].iov_base	= prefix;
+    iov[1].iov_base	= const_cast<void *>(frame);
+    iov[1].iov_len	= size;
+
+    if (format == fixed32)
+    {
+	prefix[0]	= size >> 24;
+	prefix[1]	= size >> 16;
+	prefix[2]	= size >> 8;
+	prefix[3]	= size;
+	iov[0].iov_len	= 4;
+    }
+    else
+    {
+	size_t		i = 0;
+	uint64_t	length = size;
+
+	do
+	{
+	    prefix[i] = (length & 0x7f) | (length > 0x7f ? 0x80 : 0);
+	    length >>= 7;
+	    i++;
+	} while (length);
+	iov[0].iov_len	= i;
+    }
+
+    socket.sendv(iov, 2, more);
+} /* JSNSockFramedChannel::send */
+
+auto JSNSockFramedChannel::next(
+	JSNSockView	&frame
+	)		-> bool
+{
+    size_t	header;
+    size_t	body;
+
+    socket.consume(pending);	/* the previous frame is released only now */
+    pending = 0;
+
+    while (1)
+    {
+	JSNSockView	data = socket.buffered() ? socket.peek() : JSNSockView { nullptr, 0 };
+
+	if (decode(data.data, data.size, header, body))
+	{
+	    frame	= JSNSockView { data.data + header, body };
+	    pending	= header + body;
+	    return true;
+	}
+
+	if (!more(header ? header + body : data.size + 10))
+	{
+	    if (data.size == 0)
+		return false;	/* clean end-of-stream between frames */
+
+	    errno = EPROTO;
+	    throw JSNException("JSNSockFramedChannel: stream ended inside a frame.");
+	}
+    }
+} /* JSNSockFramedChannel::next */
+
+auto JSNSockFramedChannel::receive(
+	std::vector<JSNSockView>	&frames
+	)				-> size_t
+{
+    size_t	header;
+    size_t	body;
+
+    socket.consume(pending);
+    pending = 0;
+    frames.clear();
+
+    while (1)
+    {
+	JSNSockView	data = socket.buffered() ? socket.peek() : JSNSockView { nullptr, 0 };
+	size_t		offset = 0;
+
+	/* one pass over everything buffered: no copies, no allocation	*/
+	/* beyond the caller's vector					*/
+	while (decode(data.data + offset, data.size - offset, header, body))
+	{
+	    frames.push_back(JSNSockView { data.data + offset + header, body });
+	    offset += header + body;
+	}
+
+	if (!frames.empty())
+	{
+	    pending = offset;
+	    return frames.size();
+	}
+
+	if (!more(header ? header + body : data.size + 10))
+	{
+	    if (data.size == 0)
+		return 0;
+
+	    errno = EPROTO;
+	    throw JSNException("JSNSockFramedChannel: stream ended inside a frame.");
+	}
+    }
+} /* JSNSockFramedChannel::receive */
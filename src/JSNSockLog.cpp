@@ -0,0 +1,248 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+
+/* Includes */
+#include "JSNSockLog.hpp"
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>	/* used for 'vsnprintf' */
+#include <cstring>
+#include <unistd.h>	/* used for 'write(2)' */
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+std::atomic<uint32_t>		JSNSockLog::threshold(JSNSockLog::warning);
+std::atomic<JSNSockLogSink *>	JSNSockLog::current(nullptr);
+
+auto JSNSockLog::name(
+	level		severity
+	)		-> const char *
+{
+    static const char	*names[] = {
+	"trace", "debug", "info", "warning", "error", "none"
+    };
+
+    return severity <= none ? names[severity] : "?";
+}
+
+auto JSNSockLog::setLevel(
+	level		lowest
+	)		-> void
+{
+    threshold.store(lowest, std::memory_order_relaxed);
+}
+
+auto JSNSockLog::setSink(
+	JSNSockLogSink	*sink
+	)		-> void
+{
+    current.store(sink, std::memory_order_release);
+}
+
+auto JSNSockLog::write(
+	level		severity,
+	const char	*format,
+	...
+	)		-> void
+{
+    static JSNSockLogDescriptor	standardError;	/* constructed on first use */
+    char		line[JSN_LOG_LINE];
+    int			prefix;
+    int			body;
+    va_list		arguments;
+    JSNSockLogSink	*target = sink();
+    int			saved = errno;	/* callers log between a failure and its throw */
+
+    prefix = snprintf(line, sizeof(line), "jsnSock %s: ", name(severity));
+    va_start(arguments, format);
+    body = vsnprintf(line + prefix, sizeof(line) - prefix - 1, format, arguments);
+    va_end(arguments);
+
+    if (body < 0)
+	body = 0;
+    else if (size_t(prefix + body) > sizeof(line) - 2)	/* cut, keeping room for the newline */
+	body = sizeof(line) - 2 - prefix;
+    line[prefix + body] = '\n';
+
+    (target ? *target : standardError).write(severity, line, prefix + body + 1);
+    errno = saved;
+} /* JSNSockLog::write */
+
+
+auto JSNSockLogDescriptor::write(
+	JSNSockLog::level	/* severity */,
+	const char		*line,
+	size_t			size
+	)			-> void
+{
+    ssize_t	n;
+
+    while (size > 0)
+    {
+	if ( (n = ::write(descriptor, line, size)) == -1 )
+	{
+	    if (errno == EINTR)
+		continue;
+	    return;	/* nowhere left to report it */
+	}
+	line += n;
+	size -= n;
+    }
+}
+
+
+JSNSockLogRing::JSNSockLogRing(
+	JSNSockLogSink	*target,
+	size_t		capacity
+	)
+: target(target ? *target : standardError),
+  head(0),
+  tail(0),
+  dropped(0),
+  sleeping(false)
+{
+    size_t	size = 1;
+
+    while (size < capacity)
+	size <<= 1;
+
+    slots.reset(new slot[size]);
+    mask = size - 1;
+    for (size_t i = 0; i < size; i++)
+	slots[i].sequence.store(i, std::memory_order_relaxed);
+
+    worker = std::thread(&JSNSockLogRing::work, this);
+}
+
+JSNSockLogRing::~JSNSockLogRing()
+{
+    JSNSockLogSink	*self = this;
+
+    /* a ring still installed would be written to after it is gone */
+    JSNSockLog::current.compare_exchange_strong(self, nullptr);
+
+    {
+	std::lock_guard<std::mutex>	guard(lock);
+	stopping = true;
+    }
+    ready.notify_one();
+    worker.join();
+}
+
+auto JSNSockLogRing::write(
+	JSNSockLog::level	severity,
+	const char		*line,
+	size_t			size
+	)			-> void
+{
+    uint64_t	position = head.load(std::memory_order_relaxed);
+    slot	*s;
+
+    /* claim a position whose slot the consumer has released */
+    while (1)
+    {
+	s = &slots[position & mask];
+
+	int64_t	lag = int64_t(s->sequence.load(std::memory_order_acquire) - position);
+
+	if (lag == 0)
+	{
+	    if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+		break;
+	}
+	else if (lag < 0)	/* full: a whole lap behind the consumer */
+	{
+	    dropped.fetch_add(1, std::memory_order_relaxed);
+	    return;
+	}
+	else
+	    position = head.load(std::memory_order_relaxed);
+    }
+
+    if (size > sizeof(s->line))
+	size = sizeof(s->line);
+    memcpy(s->line, line, size);
+    s->severity	= severity;
+    s->size	= size;
+    /* sequentially consistent with 'work' going to sleep: either it	*/
+    /* sees this line before waiting or we see it asleep and wake it	*/
+    s->sequence.store(position + 1, std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_seq_cst))
+    {
+	std::lock_guard<std::mutex>	guard(lock);
+	ready.notify_one();
+    }
+} /* JSNSockLogRing::write */
+
+auto JSNSockLogRing::work(
+	)		-> void
+{
+    uint64_t	position = tail.load(std::memory_order_relaxed);
+
+    while (1)
+    {
+	slot	&s = slots[position & mask];
+
+	if (s.sequence.load(std::memory_order_acquire) == position + 1)
+	{
+	    target.write(s.severity, s.line, s.size);
+	    s.sequence.store(position + mask + 1, std::memory_order_release);
+	    tail.store(++position, std::memory_order_release);
+	    continue;
+	}
+
+	uint64_t	lost = dropped.load(std::memory_order_relaxed);
+
+	if (lost != reported)
+	{
+	    char	line[JSN_LOG_LINE];
+	    int		size = snprintf(line, sizeof(line), "jsnSock %s: %llu log message(s) dropped, the ring was full\n",
+				JSNSockLog::name(JSNSockLog::warning), (unsigned long long) (lost - reported));
+
+	    reported = lost;
+	    target.write(JSNSockLog::warning, line, size);
+	}
+
+	std::unique_lock<std::mutex>	guard(lock);
+
+	if (stopping)
+	    break;
+
+	sleeping.store(true, std::memory_order_seq_cst);
+	if (s.sequence.load(std::memory_order_seq_cst) != position + 1)
+	    ready.wait(guard);
+	sleeping.store(false, std::memory_order_relaxed);
+    }
+} /* JSNSockLogRing::work */
+
+auto JSNSockLogRing::flush(
+	)			-> void
+{
+    uint64_t	until = head.load(std::memory_order_acquire);
+
+    /* the consumer only sleeps once it has caught up, so this is brief */
+    while (tail.load(std::memory_order_acquire) < until)
+	std::this_thread::yield();
+}
@@ -0,0 +1,284 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+/* Includes */
+#include "JSNSockMetrics.hpp"
+#include <cmath>	/* used for 'ceil' */
+#include <locale>
+#include <sstream>
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+namespace
+{
+    /* One thread's (or a few threads') share of the process-wide metrics.	*/
+    /* Static storage: zeroed, and untouched pages cost nothing.		*/
+    struct shard
+    {
+	std::atomic<uint64_t>	counts[JSNSockCounters::counters];
+	std::atomic<uint64_t>	total[JSNSockMetrics::histograms];
+	std::atomic<uint64_t>	sum[JSNSockMetrics::histograms];
+	std::atomic<uint64_t>	buckets[JSNSockMetrics::histograms][JSNSockHistogram::buckets];
+	char			pad[64];	/* keeps neighbouring shards off each other's lines */
+    };
+
+    shard			shards[JSN_METRICS_SHARDS];
+    std::atomic<uint32_t>	nextShard(0);
+
+    auto local (
+	    )			-> shard &
+    {
+	static thread_local uint32_t	mine = nextShard.fetch_add(1, std::memory_order_relaxed)
+						% JSN_METRICS_SHARDS;
+	return shards[mine];
+    }
+} /* namespace */
+
+std::atomic<bool>	JSNSockMetrics::active(false);
+const uint32_t		JSNSockHistogram::sub;
+const uint32_t		JSNSockHistogram::buckets;
+
+auto JSNSockCounters::name(
+	counter		c
+	)		-> const char *
+{
+    static const char	*names[counters] = {
+	"bytes_sent", "bytes_received", "sends", "recvs",
+	"partial_writes", "would_block", "accepts", "accept_errors", "connects"
+    };
+
+    return names[c];
+}
+
+auto JSNSockCounters::operator+=(
+	const JSNSockCounters	&other
+	)			-> JSNSockCounters &
+{
+    for (uint32_t c = 0; c < counters; c++)
+	value[c] += other.value[c];
+
+    return *this;
+}
+
+auto JSNSockHistogram::highest(
+	uint32_t	bucket
+	)		-> uint64_t
+{
+    if (bucket < sub)
+	return bucket;
+
+    uint32_t	shift = (bucket >> JSN_HISTOGRAM_SUB_BITS) - 1;
+    uint64_t	first = uint64_t((bucket & (sub - 1)) + sub) << shift;
+
+    return first + ((uint64_t(1) << shift) - 1);
+}
+
+auto JSNSockHistogram::record(
+	uint64_t	value
+	)		-> void
+{
+    counts[bucket(value)]++;
+    total++;
+    sum += value;
+}
+
+auto JSNSockHistogram::operator+=(
+	const JSNSockHistogram	&other
+	)			-> JSNSockHistogram &
+{
+    for (uint32_t b = 0; b < buckets; b++)
+	counts[b] += other.counts[b];
+    total	+= other.total;
+    sum		+= other.sum;
+
+    return *this;
+}
+
+auto JSNSockHistogram::percentile(
+	double		fraction
+	) const		-> uint64_t
+{
+    uint64_t	rank = uint64_t(std::ceil(fraction * total));
+    uint64_t	seen = 0;
+
+    if (total == 0)
+	return 0;
+    if (rank == 0)
+	rank = 1;
+
+    for (uint32_t b = 0; b < buckets; b++)
+	if ( (seen += counts[b]) >= rank )
+	    return highest(b);
+
+    return highest(buckets - 1);
+} /* JSNSockHistogram::percentile */
+
+auto JSNSockMetrics::name(
+	histogram	h
+	)		-> const char *
+{
+    static const char	*names[histograms] = {
+	"connect_time_ns", "send_wait_ns", "recv_wait_ns"
+    };
+
+    return names[h];
+}
+
+auto JSNSockMetrics::enable(
+	bool		on
+	)		-> void
+{
+    active.store(on, std::memory_order_relaxed);
+}
+
+auto JSNSockMetrics::count(
+	JSNSockCounters::counter	c,
+	uint64_t			n
+	)				-> void
+{
+    local().counts[c].fetch_add(n, std::memory_order_relaxed);
+}
+
+auto JSNSockMetrics::record(
+	histogram	h,
+	uint64_t	nanoseconds
+	)		-> void
+{
+    if (h >= histograms || !enabled())
+	return;
+
+    shard	&s = local();
+
+    s.buckets[h][JSNSockHistogram::bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    s.total[h].fetch_add(1, std::memory_order_relaxed);
+    s.sum[h].fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+auto JSNSockMetrics::collect(
+	)		-> snapshot
+{
+    snapshot	result;
+
+    for (shard &s : shards)
+    {
+	for (uint32_t c = 0; c < JSNSockCounters::counters; c++)
+	    result.counters.value[c] += s.counts[c].load(std::memory_order_relaxed);
+
+	for (uint32_t h = 0; h < histograms; h++)
+	{
+	    JSNSockHistogram	&latency = result.latency[h];
+
+	    for (uint32_t b = 0; b < JSNSockHistogram::buckets; b++)
+		latency.counts[b] += s.buckets[h][b].load(std::memory_order_relaxed);
+	    latency.total	+= s.total[h].load(std::memory_order_relaxed);
+	    latency.sum		+= s.sum[h].load(std::memory_order_relaxed);
+	}
+    }
+
+    return result;
+} /* JSNSockMetrics::collect */
+
+auto JSNSockMetrics::reset(
+	)		-> void
+{
+    for (shard &s : shards)
+    {
+	for (auto &value : s.counts)
+	    value.store(0, std::memory_order_relaxed);
+
+	for (uint32_t h = 0; h < histograms; h++)
+	{
+	    for (auto &value : s.buckets[h])
+		value.store(0, std::memory_order_relaxed);
+	    s.total[h].store(0, std::memory_order_relaxed);
+	    s.sum[h].store(0, std::memory_order_relaxed);
+	}
+    }
+}
+
+auto JSNSockMetrics::text(
+	const snapshot	&metrics
+	)		-> std::string
+{
+    /* labels spelled out, not formatted: the output must not follow the locale */
+    static const char	*quantiles[] = { "0.5", "0.9", "0.99", "0.999", "1" };
+    static const double	fractions[] = { 0.5, 0.9, 0.99, 0.999, 1.0 };
+    std::ostringstream	out;
+
+    out.imbue(std::locale::classic());
+
+    for (uint32_t c = 0; c < JSNSockCounters::counters; c++)
+	out << "jsnsock_" << JSNSockCounters::name(JSNSockCounters::counter(c))
+	    << ' ' << metrics.counters.value[c] << '\n';
+
+    for (uint32_t h = 0; h < histograms; h++)
+    {
+	const JSNSockHistogram	&latency = metrics.latency[h];
+	const char		*label = name(histogram(h));
+
+	out << "jsnsock_" << label << "_count " << latency.total << '\n'
+	    << "jsnsock_" << label << "_sum " << latency.sum << '\n'
+	    << "jsnsock_" << label << "_mean " << latency.mean() << '\n';
+	for (size_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]); q++)
+	    out << "jsnsock_" << label << "{quantile=\"" << quantiles[q] << "\"} "
+		<< latency.percentile(fractions[q]) << '\n';
+    }
+
+    return out.str();
+} /* JSNSockMetrics::text */
+
+JSNSockCounterSet::JSNSockCounterSet(
+	)
+{
+    for (auto &v : value)
+	v.store(0, std::memory_order_relaxed);
+}
+
+JSNSockCounterSet::JSNSockCounterSet(
+	const JSNSockCounterSet	&other
+	)
+{
+    *this = other;
+}
+
+auto JSNSockCounterSet::operator=(
+	const JSNSockCounterSet	&other
+	)			-> JSNSockCounterSet &
+{
+    for (uint32_t c = 0; c < JSNSockCounters::counters; c++)
+	value[c].store(other.value[c].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    return *this;
+}
+
+auto JSNSockCounterSet::snapshot(
+	) const			-> JSNSockCounters
+{
+    JSNSockCounters	result;
+
+    for (uint32_t c = 0; c < JSNSockCounters::counters; c++)
+	result.value[c] = value[c].load(std::memory_order_relaxed);
+
+    return result;
+}
@@ -0,0 +1,245 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+
+/* Includes */
+#include "JSNSockPool.hpp"
+#include <poll.h>
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+JSNSockTCPPool::lease::lease(
+	lease		&&other
+	) noexcept
+: pool(other.pool), key(std::move(other.key)), socket(std::move(other.socket))
+{
+    other.pool = nullptr;
+}
+
+JSNSockTCPPool::lease::~lease()
+{
+    if (pool == nullptr)	/* moved from */
+	return;
+
+    if (socket.valid())
+	pool->give(key, std::move(socket));
+    else
+	pool->forget(key);
+}
+
+auto JSNSockTCPPool::lease::discard(
+	)		-> void
+{
+    socket.close();	/* the destructor then only releases the slot */
+}
+
+
+JSNSockTCPPool::JSNSockTCPPool(
+	uint32_t	maxPerHost,
+	double		idleTimeout,
+	double		timeout
+	)
+: maxPerHost(maxPerHost ? maxPerHost : 1), timeout(timeout)
+{
+    this->idleTimeout = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(idleTimeout));
+}
+
+auto JSNSockTCPPool::alive(
+	JSNSockTCP	&socket
+	)		-> bool
+{
+    struct pollfd	pfd;
+    char		byte;
+
+    if (!socket.valid() || socket.buffered())
+	return false;
+
+    pfd.fd	= socket.descriptor();
+    pfd.events	= POLLIN | POLLRDHUP;
+
+    if (::poll(&pfd, 1, 0) == 0)
+	return true;	/* quiet: the usual case, one syscall */
+
+    if (pfd.revents & (POLLRDHUP | POLLHUP | POLLERR | POLLNVAL))
+	return false;
+
+    /* readable but not hung up: unsolicited data (or a FIN racing in) */
+    return ::recv(pfd.fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == -1 && errno == EAGAIN;
+}
+
+auto JSNSockTCPPool::open(
+	const std::string	&host,
+	uint16_t		port
+	)			-> JSNSockTCP
+{
+    int		on = 1;
+    JSNSockTCP	socket(host, port, timeout);
+
+    socket.setSockOption(SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+    return socket;
+}
+
+auto JSNSockTCPPool::give(
+	const std::string	&key,
+	JSNSockTCP		&&socket
+	)			-> void
+{
+    {
+	std::lock_guard<std::mutex>	guard(lock);
+	endpoints[key].idle.push_back(std::make_pair(std::move(socket), clock::now()));
+    }
+    returned.notify_all();
+}
+
+auto JSNSockTCPPool::forget(
+	const std::string	&key
+	)			-> void
+{
+    {
+	std::lock_guard<std::mutex>	guard(lock);
+	endpoints[key].open--;
+    }
+    returned.notify_all();
+}
+
+auto JSNSockTCPPool::acquire(
+	const std::string	&host,
+	uint16_t		port
+	)			-> lease
+{
+    std::string				key = host + ':' + std::to_string(port);
+    std::unique_lock<std::mutex>	guard(lock);
+    endpoint				&e = endpoints[key];
+    clock::time_point			limit = (timeout == 0.0) ? clock::time_point::max() :
+		clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(timeout));
+
+    while (1)
+    {
+	clock::time_point	now = clock::now();
+
+	/* most recently used first: it is the least likely to have expired */
+	while (!e.idle.empty())
+	{
+	    JSNSockTCP		socket = std::move(e.idle.back().first);
+	    clock::time_point	since = e.idle.back().second;
+	    e.idle.pop_back();
+
+	    if (now - since < idleTimeout && alive(socket))
+		return lease(this, key, std::move(socket));
+
+	    e.open--;	/* 'socket' closes as it goes out of scope */
+	}
+
+	if (e.open < maxPerHost)
+	    break;
+
+	if (limit == clock::time_point::max())
+	    returned.wait(guard);
+	else if (returned.wait_until(guard, limit) == std::cv_status::timeout)
+	{
+	    errno = ETIMEDOUT;
+	    throw JSNException("JSNSockTCPPool: timed-out waiting for a connection.");
+	}
+    }
+
+    e.open++;	/* reserve the slot, then connect without holding the lock */
+    guard.unlock();
+
+    try
+    {
+	return lease(this, key, open(host, port));
+    }
+    catch (...)
+    {
+	forget(key);
+	throw;
+    }
+} /* JSNSockTCPPool::acquire */
+
+auto JSNSockTCPPool::warm(
+	const std::string	&host,
+	uint16_t		port,
+	uint32_t		count
+	)			-> void
+{
+    std::string		key = host + ':' + std::to_string(port);
+
+    while (1)
+    {
+	{
+	    std::lock_guard<std::mutex>	guard(lock);
+	    endpoint			&e = endpoints[key];
+
+	    if (e.idle.size() >= count || e.open >= maxPerHost)
+		return;
+	    e.open++;
+	}
+
+	try
+	{
+	    give(key, open(host, port));
+	}
+	catch (...)
+	{
+	    forget(key);
+	    throw;
+	}
+    }
+} /* JSNSockTCPPool::warm */
+
+auto JSNSockTCPPool::purge(
+	)			-> void
+{
+    std::lock_guard<std::mutex>	guard(lock);
+    clock::time_point		now = clock::now();
+
+    for (auto &entry : endpoints)
+    {
+	auto	&idle = entry.second.idle;
+
+	for (auto found = idle.begin(); found != idle.end(); )
+	{
+	    if (now - found->second >= idleTimeout || !alive(found->first))
+	    {
+		found = idle.erase(found);
+		entry.second.open--;
+	    }
+	    else
+		++found;
+	}
+    }
+
+    returned.notify_all();	/* slots may have been freed */
+}
+
+auto JSNSockTCPPool::idle(
+	const std::string	&host,
+	uint16_t		port
+	)			-> size_t
+{
+    std::lock_guard<std::mutex>	guard(lock);
+    auto found = endpoints.find(host + ':' + std::to_string(port));
+
+    return (found == endpoints.end()) ? 0 : found->second.idle.size();
+}
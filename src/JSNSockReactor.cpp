@@ -0,0 +1,337 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+/* Includes */
+#include "JSNSockReactor.hpp"
+#include <sys/eventfd.h>
+#include <algorithm>
+#include <unistd.h>	/* used for 'close(2)', 'read(2)' and 'write(2)' */
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+JSNSockReactor::JSNSockReactor(
+	uint32_t	maxEvents
+	)
+: stopped(false), events(maxEvents ? maxEvents : 1), nextToken(1)
+{
+    if ( (epollDesc = epoll_create1(EPOLL_CLOEXEC)) == -1 )
+	throw JSNException("JSNSockReactor: unable to create an epoll descriptor.");
+
+    if ( (wakeDesc = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1 )
+    {
+	::close(epollDesc);
+	throw JSNException("JSNSockReactor: unable to create a wake-up eventfd.");
+    }
+
+    struct epoll_event	ev;
+    ev.events	= EPOLLIN;
+    ev.data.ptr	= nullptr;	/* a null registration marks the wake-up descriptor */
+
+    if ( epoll_ctl(epollDesc, EPOLL_CTL_ADD, wakeDesc, &ev) == -1 )
+    {
+	::close(wakeDesc);
+	::close(epollDesc);
+	throw JSNException("JSNSockReactor: unable to register the wake-up eventfd.");
+    }
+}
+
+JSNSockReactor::~JSNSockReactor()
+{
+    reap();	/* first: a retired watcher may still be listed by its descriptor */
+    for (auto &entry : registry)
+    {
+	for (registration *w : entry.second->watchers)
+	    delete w;
+	delete entry.second;
+    }
+
+    ::close(wakeDesc);
+    ::close(epollDesc);
+}
+
+auto JSNSockReactor::reap(
+	)		-> void
+{
+    /* a watcher dropped by 'unwatch' leaves a descriptor that stays */
+    for (registration *r : retired)
+	if (r->owner != nullptr && r->owner->live)
+	{
+	    std::vector<registration *>	&list = r->owner->watchers;
+	    list.erase(std::remove(list.begin(), list.end(), r), list.end());
+	}
+
+    for (registration *r : retired)
+	delete r;
+    retired.clear();
+}
+
+auto JSNSockReactor::update(
+	registration	*r
+	)		-> int
+{
+    struct epoll_event	ev;
+
+    ev.events	= r->events | EPOLLET;
+    ev.data.ptr	= r;
+    for (registration *w : r->watchers)
+	if (w->live)
+	    ev.events |= w->events;
+
+    return epoll_ctl(epollDesc, EPOLL_CTL_MOD, r->fd, &ev);
+}
+
+auto JSNSockReactor::add(
+	int		fd,
+	uint32_t	events,
+	callback	handler
+	)		-> void
+{
+    auto found = registry.find(fd);
+    if (found != registry.end())
+    {
+	registration	*r = found->second;
+
+	if (r->handler)
+	    throw JSNException("JSNSockReactor: descriptor is already registered.");
+
+	/* only watched so far: the owner takes the registration over */
+	r->handler	= std::move(handler);
+	r->events	= events;
+	if ( update(r) == 0 )
+	    return;
+	if (errno != ENOENT)
+	{
+	    r->handler	= nullptr;
+	    r->events	= 0;
+	    throw JSNException("JSNSockReactor: unable to register descriptor (epoll_ctl).");
+	}
+
+	/* the watched descriptor was closed and its number reused */
+	handler = std::move(r->handler);
+	remove(fd);
+    }
+
+    registration	*r = new registration { fd, true, std::move(handler), events, nullptr, 0, {} };
+    struct epoll_event	ev;
+
+    ev.events	= events | EPOLLET;
+    ev.data.ptr	= r;
+
+    if ( epoll_ctl(epollDesc, EPOLL_CTL_ADD, fd, &ev) == -1 )
+    {
+	delete r;
+	throw JSNException("JSNSockReactor: unable to register descriptor (epoll_ctl).");
+    }
+
+    registry[fd] = r;
+} /* JSNSockReactor::add */
+
+auto JSNSockReactor::modify(
+	int		fd,
+	uint32_t	events
+	)		-> void
+{
+    auto found = registry.find(fd);
+    if (found == registry.end())
+	throw JSNException("JSNSockReactor: descriptor is not registered.");
+
+    found->second->events = events;
+    if ( update(found->second) == -1 )
+	throw JSNException("JSNSockReactor: unable to modify descriptor (epoll_ctl).");
+} /* JSNSockReactor::modify */
+
+auto JSNSockReactor::remove(
+	int		fd
+	)		-> void
+{
+    auto found = registry.find(fd);
+    if (found == registry.end())
+	return;
+
+    /* A descriptor that was already closed has left the epoll set on its	*/
+    /* own; EBADF and ENOENT are therefore expected here and ignored.	*/
+    epoll_ctl(epollDesc, EPOLL_CTL_DEL, fd, nullptr);
+
+    for (registration *w : found->second->watchers)	/* they go with it */
+	if (w->live)
+	{
+	    w->live = false;
+	    watching.erase(w->token);
+	    retired.push_back(w);
+	}
+
+    found->second->live = false;
+    retired.push_back(found->second);	/* may still be referenced by the current batch */
+    registry.erase(found);
+} /* JSNSockReactor::remove */
+
+auto JSNSockReactor::watch(
+	int		fd,
+	uint32_t	events,
+	callback	handler
+	)		-> uint64_t
+{
+    registration	*r = nullptr;
+    registration	*w;
+    auto		found = registry.find(fd);
+
+    if (found != registry.end())
+    {
+	r = found->second;
+	w = new registration { fd, true, std::move(handler), events, r, nextToken++, {} };
+	r->watchers.push_back(w);
+
+	if ( update(r) == -1 )
+	{
+	    int		code = errno;
+
+	    r->watchers.pop_back();
+	    handler = std::move(w->handler);
+	    delete w;
+	    errno = code;
+	    if (code != ENOENT)
+		throw JSNException("JSNSockReactor: unable to watch descriptor (epoll_ctl).");
+
+	    /* the descriptor was closed and its number reused */
+	    remove(fd);
+	    r = nullptr;
+	}
+    }
+
+    if (r == nullptr)	/* nobody owns it (yet) */
+    {
+	struct epoll_event	ev;
+
+	r		= new registration { fd, true, nullptr, 0, nullptr, 0, {} };
+	ev.events	= events | EPOLLET;
+	ev.data.ptr	= r;
+
+	if ( epoll_ctl(epollDesc, EPOLL_CTL_ADD, fd, &ev) == -1 )
+	{
+	    delete r;
+	    throw JSNException("JSNSockReactor: unable to watch descriptor (epoll_ctl).");
+	}
+	registry[fd] = r;
+
+	w = new registration { fd, true, std::move(handler), events, r, nextToken++, {} };
+	r->watchers.push_back(w);
+    }
+
+    watching[w->token] = w;
+    return w->token;
+} /* JSNSockReactor::watch */
+
+auto JSNSockReactor::unwatch(
+	uint64_t	token
+	)		-> void
+{
+    auto found = watching.find(token);
+    if (found == watching.end())
+	return;
+
+    registration	*w = found->second;
+    registration	*r = w->owner;
+    bool		watched = false;
+
+    watching.erase(found);
+    w->live = false;
+    retired.push_back(w);	/* unlisted from its descriptor by 'reap' */
+
+    for (registration *other : r->watchers)
+	watched = watched || other->live;
+
+    if (!r->handler && !watched)
+	remove(r->fd);
+    else
+	update(r);	/* a failure (closed descriptor) leaves only extra wake-ups */
+} /* JSNSockReactor::unwatch */
+
+auto JSNSockReactor::poll(
+	int		timeout
+	)		-> uint32_t
+{
+    int		ready;
+    uint32_t	dispatched = 0;
+
+    if ( (ready = epoll_wait(epollDesc, events.data(), events.size(), timeout)) == -1 )
+    {
+	if (errno == EINTR)
+	    return 0;
+	throw JSNException("JSNSockReactor: epoll_wait exception.");
+    }
+
+    for (int i = 0; i < ready; i++)
+    {
+	registration *r = static_cast<registration *>(events[i].data.ptr);
+
+	if (r == nullptr)	/* woken by 'stop' */
+	{
+	    uint64_t	count;
+	    while (::read(wakeDesc, &count, sizeof(count)) > 0)
+		;
+	    continue;
+	}
+
+	if (r->live)
+	{
+	    uint32_t	happened = events[i].events;
+	    uint32_t	always = EPOLLERR | EPOLLHUP;
+
+	    /* each party sees only what it asked for; a watcher added or	*/
+	    /* dropped by a callback is taken into account at once		*/
+	    if (r->handler && (happened & (r->events | always)))
+		r->handler(happened & (r->events | always));
+	    for (size_t w = 0; r->live && w < r->watchers.size(); w++)
+	    {
+		registration	*watcher = r->watchers[w];
+
+		if (watcher->live && (happened & (watcher->events | always)))
+		    watcher->handler(happened & (watcher->events | always));
+	    }
+	    dispatched++;
+	}
+    }
+
+    reap();
+
+    return dispatched;
+} /* JSNSockReactor::poll */
+
+auto JSNSockReactor::run(
+	)		-> void
+{
+    while (!stopped)
+	poll();
+    stopped = false;	/* a stopped reactor may be run again */
+}
+
+auto JSNSockReactor::stop(
+	)		-> void
+{
+    uint64_t	one = 1;
+
+    stopped = true;
+    if ( ::write(wakeDesc, &one, sizeof(one)) == -1 && errno != EAGAIN )
+	throw JSNException("JSNSockReactor: unable to wake the event loop.");
+}
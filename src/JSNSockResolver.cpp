@@ -0,0 +1,338 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+
+/* Includes */
+#include "JSNSockResolver.hpp"
+#include <arpa/inet.h>	/* used for 'inet_pton' and 'inet_ntop' */
+#include <netdb.h>	/* used for 'getaddrinfo' */
+#include <string.h>
+#include <future>
+#include <memory>
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+auto JSNSockAddress::port(
+	) const		-> uint16_t
+{
+    if (family() == AF_INET6)
+	return ntohs(reinterpret_cast<const struct sockaddr_in6 *>(&storage)->sin6_port);
+    return ntohs(reinterpret_cast<const struct sockaddr_in *>(&storage)->sin_port);
+}
+
+auto JSNSockAddress::setPort(
+	uint16_t	port
+	)		-> void
+{
+    if (family() == AF_INET6)
+	reinterpret_cast<struct sockaddr_in6 *>(&storage)->sin6_port = htons(port);
+    else
+	reinterpret_cast<struct sockaddr_in *>(&storage)->sin_port = htons(port);
+}
+
+auto JSNSockAddress::str(
+	) const		-> std::string
+{
+    char	text[INET6_ADDRSTRLEN] = "";
+
+    if (family() == AF_INET6)
+	inet_ntop(AF_INET6, &reinterpret_cast<const struct sockaddr_in6 *>(&storage)->sin6_addr, text, sizeof(text));
+    else
+	inet_ntop(AF_INET, &reinterpret_cast<const struct sockaddr_in *>(&storage)->sin_addr, text, sizeof(text));
+
+    return std::string(text);
+}
+
+
+JSNSockResolver::JSNSockResolver(
+	double		ttl,
+	double		negativeTtl
+	)
+: stopping(false)
+{
+    setTTL(ttl, negativeTtl);
+}
+
+JSNSockResolver::~JSNSockResolver()
+{
+    {
+	std::lock_guard<std::mutex>	guard(lock);
+	stopping = true;
+    }
+    ready.notify_all();
+
+    if (worker.joinable())
+	worker.join();
+}
+
+auto JSNSockResolver::shared(
+	)		-> JSNSockResolver &
+{
+    static JSNSockResolver	resolver;
+    return resolver;
+}
+
+auto JSNSockResolver::setTTL(
+	double		ttl,
+	double		negativeTtl
+	)		-> void
+{
+    std::lock_guard<std::mutex>	guard(lock);
+
+    this->ttl		= std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(ttl));
+    this->negativeTtl	= std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(negativeTtl));
+}
+
+auto JSNSockResolver::flush(
+	)		-> void
+{
+    std::lock_guard<std::mutex>	guard(lock);
+
+    for (auto found = cache.begin(); found != cache.end(); )
+    {
+	if (found->second.resolving)	/* its waiters still need the answer */
+	    ++found;
+	else
+	    found = cache.erase(found);
+    }
+}
+
+auto JSNSockResolver::purge(
+	clock::time_point	now
+	)			-> void
+{
+    for (auto found = cache.begin(); found != cache.end(); )
+    {
+	if (!found->second.resolving && found->second.expiry <= now)
+	    found = cache.erase(found);
+	else
+	    ++found;
+    }
+}
+
+auto JSNSockResolver::numeric(
+	const std::string	&host,
+	int			family,
+	addresses		&result
+	)			-> bool
+{
+    JSNSockAddress	address;
+
+    memset(&address, 0, sizeof(address));
+
+    if (family != AF_INET6 &&
+	    inet_pton(AF_INET, host.c_str(), &reinterpret_cast<struct sockaddr_in *>(&address.storage)->sin_addr) == 1)
+    {
+	address.storage.ss_family	= AF_INET;
+	address.length			= sizeof(struct sockaddr_in);
+    }
+    else if (family != AF_INET &&
+	    inet_pton(AF_INET6, host.c_str(), &reinterpret_cast<struct sockaddr_in6 *>(&address.storage)->sin6_addr) == 1)
+    {
+	address.storage.ss_family	= AF_INET6;
+	address.length			= sizeof(struct sockaddr_in6);
+    }
+    else
+	return false;
+
+    result.assign(1, address);
+    return true;
+}
+
+auto JSNSockResolver::lookup(
+	const std::string	&host,
+	int			family,
+	addresses		&result
+	)			-> int
+{
+    struct addrinfo	hints;
+    struct addrinfo	*list;
+    int			status;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family	= family;
+    hints.ai_socktype	= SOCK_STREAM;	/* one entry per address, not per socket type */
+    hints.ai_flags	= AI_ADDRCONFIG;
+
+    if ( (status = getaddrinfo(host.c_str(), nullptr, &hints, &list)) != 0 )
+    {
+	if (status == EAI_SYSTEM)
+	    return errno;
+	else if (status == EAI_AGAIN)
+	    return EAGAIN;
+	return EHOSTUNREACH;
+    }
+
+    result.clear();
+    for (struct addrinfo *ai = list; ai; ai = ai->ai_next)
+    {
+	JSNSockAddress	address;
+
+	if (ai->ai_addrlen > sizeof(address.storage))
+	    continue;
+	memset(&address, 0, sizeof(address));
+	memcpy(&address.storage, ai->ai_addr, ai->ai_addrlen);
+	address.length = ai->ai_addrlen;
+	result.push_back(address);
+    }
+    freeaddrinfo(list);
+
+    return result.empty() ? EHOSTUNREACH : 0;
+}
+
+auto JSNSockResolver::work(
+	)		-> void
+{
+    std::unique_lock<std::mutex>	guard(lock);
+
+    while (1)
+    {
+	ready.wait(guard, [this] { return stopping || !queue.empty(); });
+	if (stopping)
+	    break;
+
+	std::pair<std::string, int>	job = std::move(queue.front());
+	queue.pop_front();
+
+	guard.unlock();
+	addresses	result;
+	int		error = lookup(job.first, job.second, result);
+	guard.lock();
+
+	std::string		key = std::to_string(job.second) + '/' + job.first;
+	entry			&e = cache[key];
+	std::vector<callback>	waiters = std::move(e.waiters);
+
+	e.result	= result;
+	e.error		= error;
+	e.expiry	= clock::now() + (error ? negativeTtl : ttl);
+	e.resolving	= false;
+	e.waiters.clear();
+
+	guard.unlock();
+	for (callback &done : waiters)
+	    done(result, error);
+	guard.lock();
+    }
+} /* JSNSockResolver::work */
+
+auto JSNSockResolver::cached(
+	const std::string	&host,
+	int			family,
+	addresses		&result
+	)			-> bool
+{
+    if (numeric(host, family, result))
+	return true;
+
+    std::lock_guard<std::mutex>	guard(lock);
+    auto found = cache.find(std::to_string(family) + '/' + host);
+
+    if (found == cache.end() || found->second.resolving || found->second.error ||
+	    found->second.expiry <= clock::now())
+	return false;
+
+    result = found->second.result;
+    return true;
+}
+
+auto JSNSockResolver::resolveAsync(
+	const std::string	&host,
+	int			family,
+	callback		done
+	)			-> void
+{
+    addresses		result;
+    int			error;
+
+    if (numeric(host, family, result))
+    {
+	done(result, 0);
+	return;
+    }
+
+    std::unique_lock<std::mutex>	guard(lock);
+    clock::time_point			now = clock::now();
+
+    if (cache.size() >= JSN_RESOLVER_CACHE_MAX)
+	purge(now);
+
+    entry &e = cache[std::to_string(family) + '/' + host];
+
+    if (!e.resolving && e.expiry > now)	/* fresh answer, positive or negative */
+    {
+	result	= e.result;
+	error	= e.error;
+	guard.unlock();
+	done(result, error);
+	return;
+    }
+
+    e.waiters.push_back(std::move(done));
+    if (!e.resolving)
+    {
+	e.resolving = true;
+	queue.push_back(std::make_pair(host, family));
+	if (!worker.joinable())
+	    worker = std::thread(&JSNSockResolver::work, this);
+	ready.notify_one();
+    }
+} /* JSNSockResolver::resolveAsync */
+
+auto JSNSockResolver::resolve(
+	const std::string	&host,
+	int			family,
+	double			timeout
+	)			-> addresses
+{
+    addresses	result;
+
+    if (cached(host, family, result))
+	return result;
+
+    /* the promise is shared: the worker may answer after we gave up */
+    auto	promise = std::make_shared<std::promise<std::pair<addresses, int>>>();
+    auto	future = promise->get_future();
+
+    resolveAsync(host, family, [promise](const addresses &result, int error)
+	    {
+		promise->set_value(std::make_pair(result, error));
+	    });
+
+    if (timeout != 0.0 &&
+	    future.wait_for(std::chrono::duration<double>(timeout)) != std::future_status::ready)
+    {
+	errno = ETIMEDOUT;
+	throw JSNException("JSNSockResolver: timed-out resolving host name.");
+    }
+
+    std::pair<addresses, int>	answer = future.get();
+    if (answer.second)
+    {
+	errno = answer.second;
+	throw JSNException("JSNSockResolver: unable to resolve host name.");
+    }
+
+    return answer.first;
+} /* JSNSockResolver::resolve */
@@ -0,0 +1,705 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+/* Includes */
+#include "JSNSockRing.hpp"
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>	/* used for 'uname(2)' */
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>	/* used for 'sscanf' */
+#include <time.h>
+#include <unistd.h>	/* used for 'syscall(2)', 'close(2)' and 'read(2)' */
+#include <algorithm>
+#include <vector>
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+
+/* The queues are shared with the kernel: indices written by one side are	*/
+/* published with release stores and read by the other with acquire loads.	*/
+static inline auto loadAcquire (const unsigned *p)		-> unsigned
+{ return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+
+static inline auto storeRelease (unsigned *p, unsigned v)	-> void
+{ __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+/* Tags the 'user_data' of a paused accept's timeout; records are aligned */
+static const uint64_t	resuming = 1;
+
+/* The running kernel's release as major * 1000 + minor; zero if unknown */
+static auto kernelRelease ()					-> int
+{
+    struct utsname	name;
+    int			major = 0;
+    int			minor = 0;
+
+    if ( uname(&name) == -1 || sscanf(name.release, "%d.%d", &major, &minor) != 2 )
+	return 0;
+    return major * 1000 + minor;
+}
+
+JSNSockRing::JSNSockRing(
+	uint32_t	entries,
+	uint32_t	buffers,
+	uint32_t	bufferSize
+	)
+: ringDesc(-1), wakeDesc(-1), stopped(false),
+  sqMap(MAP_FAILED), sqMapSize(0), cqMap(MAP_FAILED), cqMapSize(0),
+  sqes(static_cast<struct io_uring_sqe *>(MAP_FAILED)), sqesSize(0), queued(0),
+  bufRing(static_cast<struct io_uring_buf_ring *>(MAP_FAILED)), bufRingSize(0),
+  bufCount(1), bufSize(bufferSize ? bufferSize : 1), bufTail(0), mapped(false)
+{
+    /* the kernel needs a power-of-two buffer ring of at most 32768 */
+    while (bufCount < buffers && bufCount < 32768)
+	bufCount <<= 1;
+
+    try
+    {
+	/* Cooperative task running avoids an interrupt per completion;	*/
+	/* kernels before 5.19 reject the flag, so retry without it.	*/
+	try
+	{
+	    setup(entries, IORING_SETUP_COOP_TASKRUN);
+	}
+	catch (JSNException &)
+	{
+	    if (errno != EINVAL)
+		throw;
+	    setup(entries, 0);
+	}
+
+	bufMemory.resize(size_t(bufCount) * bufSize);
+	if ( (mapped = mapBuffers()) )
+	{
+	    for (uint32_t bid = 0; bid < bufCount; bid++)
+		recycle(bid);
+	}
+	else
+	{
+	    struct io_uring_sqe *sqe = acquire();	/* every buffer, in one submission */
+	    sqe->opcode	= IORING_OP_PROVIDE_BUFFERS;
+	    sqe->flags	= IOSQE_CQE_SKIP_SUCCESS;
+	    sqe->fd		= bufCount;
+	    sqe->addr	= reinterpret_cast<uint64_t>(bufMemory.data());
+	    sqe->len	= bufSize;
+	    sqe->off	= 0;
+	    sqe->buf_group	= 0;
+	    commit();
+	}
+
+	if ( (wakeDesc = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1 )
+	    throw JSNException("JSNSockRing: unable to create a wake-up eventfd.");
+
+	wake.type	= waker;
+	wake.fd		= wakeDesc;
+	wake.live	= true;
+	wake.sent	= 0;
+	arm(&wake);
+    }
+    catch (...)
+    {
+	teardown();
+	throw;
+    }
+}
+
+JSNSockRing::~JSNSockRing()
+{
+    /* Cancel everything and wait for the final completions, so the	*/
+    /* kernel is no longer using any buffer or record when they are freed */
+    for (auto &entry : operations)
+	entry.second->live = false;
+    for (auto &entry : operations)
+    {
+	struct io_uring_sqe *sqe = acquire();
+	sqe->opcode	= IORING_OP_ASYNC_CANCEL;
+	sqe->addr	= reinterpret_cast<uint64_t>(entry.second);
+	commit();
+
+	if (entry.second->type == acceptor)	/* or its backoff, if paused */
+	{
+	    sqe = acquire();
+	    sqe->opcode	= IORING_OP_ASYNC_CANCEL;
+	    sqe->addr	= reinterpret_cast<uint64_t>(entry.second) | resuming;
+	    commit();
+	}
+    }
+
+    try
+    {
+	for (int attempts = 0; !operations.empty() && attempts < 100; attempts++)
+	    poll(10);
+    }
+    catch (JSNException &)
+    {
+    }
+
+    for (auto &entry : operations)
+	delete entry.second;
+    operations.clear();
+    reap(retired.size());
+
+    teardown();
+}
+
+auto JSNSockRing::setup(
+	uint32_t	entries,
+	uint32_t	flags
+	)		-> void
+{
+    struct io_uring_params	params;
+
+    memset(&params, 0, sizeof(params));
+    params.flags	= flags | IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP;
+    params.cq_entries	= std::max<uint32_t>(entries, 1) * 4;	/* multishot completions outnumber submissions */
+
+    if ( (ringDesc = syscall(__NR_io_uring_setup, std::max<uint32_t>(entries, 1), &params)) == -1 )
+	throw JSNException("JSNSockRing: io_uring_setup exception.");
+
+    if ( !(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)
+	    || !(params.features & IORING_FEAT_NODROP) )
+    {
+	::close(ringDesc);
+	ringDesc = -1;
+	errno = ENOSYS;
+	throw JSNException("JSNSockRing: this kernel's io_uring is too old.");
+    }
+
+    sqMapSize	= params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqMapSize	= params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    sqMapSize	= cqMapSize = std::max(sqMapSize, cqMapSize);	/* one mapping holds both */
+
+    sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	    ringDesc, IORING_OFF_SQ_RING);
+    if (sqMap == MAP_FAILED)
+	throw JSNException("JSNSockRing: unable to map the queues.");
+    cqMap = sqMap;
+
+    sqesSize	= params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes	= static_cast<struct io_uring_sqe *>(mmap(nullptr, sqesSize,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDesc, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED)
+	throw JSNException("JSNSockRing: unable to map the submission entries.");
+
+    char	*sq = static_cast<char *>(sqMap);
+    char	*cq = static_cast<char *>(cqMap);
+
+    sqHead	= reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail	= reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqArray	= reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sqMask	= *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqEntries	= *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_entries);
+    cqHead	= reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail	= reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask	= *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes	= reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+} /* JSNSockRing::setup */
+
+auto JSNSockRing::teardown(
+	)		-> void
+{
+    if (sqes != MAP_FAILED)
+	munmap(sqes, sqesSize);
+    if (sqMap != MAP_FAILED)
+	munmap(sqMap, sqMapSize);
+    if (ringDesc != -1)
+	::close(ringDesc);	/* before the buffer ring: the kernel unregisters it */
+    if (bufRing != MAP_FAILED)
+	munmap(bufRing, bufRingSize);
+    if (wakeDesc != -1)
+	::close(wakeDesc);
+
+    sqes	= static_cast<struct io_uring_sqe *>(MAP_FAILED);
+    sqMap	= cqMap = MAP_FAILED;
+    bufRing	= static_cast<struct io_uring_buf_ring *>(MAP_FAILED);
+    ringDesc	= wakeDesc = -1;
+}
+
+auto JSNSockRing::mapBuffers(
+	)		-> bool
+{
+    struct io_uring_buf_reg	reg;
+
+    bufRingSize	= bufCount * sizeof(struct io_uring_buf);
+    bufRing	= static_cast<struct io_uring_buf_ring *>(mmap(nullptr, bufRingSize,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (bufRing == MAP_FAILED)
+	return false;
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr	= reinterpret_cast<uint64_t>(bufRing);
+    reg.ring_entries	= bufCount;
+    reg.bgid		= 0;
+
+    /* kernels before 5.19 have no buffer rings */
+    if ( syscall(__NR_io_uring_register, ringDesc, IORING_REGISTER_PBUF_RING, &reg, 1) == -1 )
+    {
+	munmap(bufRing, bufRingSize);
+	bufRing = static_cast<struct io_uring_buf_ring *>(MAP_FAILED);
+	return false;
+    }
+
+    return true;
+} /* JSNSockRing::mapBuffers */
+
+auto JSNSockRing::available(
+	)		-> bool
+{
+    static const bool	supported = []()
+    {
+	/* Older kernels know the opcodes but fail each submission that	*/
+	/* asks for multishot, which the probe below cannot see: accept	*/
+	/* needs 5.19 and receive 6.0.					*/
+	if (kernelRelease() < 6000)
+	    return false;
+
+	try
+	{
+	    JSNSockRing		trial(4, 1, 64);
+	    std::vector<char>	buffer(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op), 0);
+	    struct io_uring_probe	*probe = reinterpret_cast<struct io_uring_probe *>(buffer.data());
+
+	    if ( syscall(__NR_io_uring_register, trial.ringDesc, IORING_REGISTER_PROBE, probe, 256) == -1 )
+		return false;
+
+	    /* every opcode 'arm', 'recycle', 'pause' and 'cancel' submit */
+	    for (int op : { IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_POLL_ADD,
+			    IORING_OP_PROVIDE_BUFFERS, IORING_OP_ASYNC_CANCEL, IORING_OP_TIMEOUT })
+		if (op >= probe->ops_len || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+		    return false;
+	    return true;
+	}
+	catch (JSNException &)
+	{
+	    return false;
+	}
+    }();
+
+    return supported;
+}
+
+auto JSNSockRing::acquire(
+	)		-> struct io_uring_sqe *
+{
+    unsigned	tail = *sqTail;	/* only this side writes the tail */
+
+    if (tail - loadAcquire(sqHead) == sqEntries)	/* full: hand the batch over now */
+	enter(queued, 0, 0);
+
+    struct io_uring_sqe	*sqe = &sqes[tail & sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+auto JSNSockRing::commit(
+	)		-> void
+{
+    unsigned	tail = *sqTail;
+
+    sqArray[tail & sqMask] = tail & sqMask;
+    storeRelease(sqTail, tail + 1);
+    queued++;
+}
+
+auto JSNSockRing::enter(
+	unsigned	submit,
+	unsigned	wait,
+	int		timeout
+	)		-> void
+{
+    struct __kernel_timespec		ts;
+    struct io_uring_getevents_arg	arg;
+    unsigned				flags = wait ? IORING_ENTER_GETEVENTS : 0;
+    void				*argp = nullptr;
+    size_t				argSize = 0;
+    long				result;
+
+    if (wait && timeout >= 0)
+    {
+	ts.tv_sec	= timeout / 1000;
+	ts.tv_nsec	= (timeout % 1000) * 1000000L;
+	memset(&arg, 0, sizeof(arg));
+	arg.ts		= reinterpret_cast<uint64_t>(&ts);
+	argp		= &arg;
+	argSize		= sizeof(arg);
+	flags		|= IORING_ENTER_EXT_ARG;
+    }
+
+    result = syscall(__NR_io_uring_enter, ringDesc, submit, wait, flags, argp, argSize);
+
+    if (result == -1)
+    {
+	/* interrupted, timed out, or a full completion queue: in every	*/
+	/* case the caller reaps whatever has completed			*/
+	if (errno == EINTR || errno == ETIME || errno == EBUSY || errno == EAGAIN)
+	    return;
+	throw JSNException("JSNSockRing: io_uring_enter exception.");
+    }
+
+    queued -= std::min<unsigned>(queued, result);
+} /* JSNSockRing::enter */
+
+auto JSNSockRing::arm(
+	operation	*op
+	)		-> void
+{
+    struct io_uring_sqe	*sqe = acquire();
+
+    sqe->fd		= op->fd;
+    sqe->user_data	= reinterpret_cast<uint64_t>(op);
+
+    switch (op->type)
+    {
+	case acceptor:
+	    sqe->opcode		= IORING_OP_ACCEPT;
+	    sqe->ioprio		= IORING_ACCEPT_MULTISHOT;
+	    sqe->accept_flags	= SOCK_NONBLOCK | SOCK_CLOEXEC;
+	    break;
+
+	case reader:
+	    sqe->opcode		= IORING_OP_RECV;
+	    sqe->ioprio		= IORING_RECV_MULTISHOT;
+	    sqe->flags		= IOSQE_BUFFER_SELECT;
+	    sqe->buf_group	= 0;
+	    break;
+
+	case writer:
+	    sqe->opcode		= IORING_OP_SEND;
+	    sqe->addr		= reinterpret_cast<uint64_t>(op->output.data() + op->sent);
+	    sqe->len		= op->output.size() - op->sent;
+	    sqe->msg_flags	= MSG_NOSIGNAL;
+	    break;
+
+	case waker:
+	    sqe->opcode		= IORING_OP_POLL_ADD;
+	    sqe->len		= IORING_POLL_ADD_MULTI;
+	    sqe->poll32_events	= POLLIN;
+	    break;
+    }
+
+    commit();
+} /* JSNSockRing::arm */
+
+auto JSNSockRing::pause(
+	operation	*op
+	)		-> void
+{
+    /* read by the kernel when the batch is submitted, so not on the stack */
+    static const struct __kernel_timespec	backoff = {
+	JSN_RING_ACCEPT_BACKOFF / 1000, (JSN_RING_ACCEPT_BACKOFF % 1000) * 1000000L };
+    struct io_uring_sqe	*sqe = acquire();
+
+    sqe->opcode		= IORING_OP_TIMEOUT;
+    sqe->addr		= reinterpret_cast<uint64_t>(&backoff);
+    sqe->len		= 1;
+    sqe->user_data	= reinterpret_cast<uint64_t>(op) | resuming;
+    commit();
+}
+
+auto JSNSockRing::recycle(
+	uint16_t	bid
+	)		-> void
+{
+    if (!mapped)	/* hand the buffer back with a submission instead */
+    {
+	struct io_uring_sqe *sqe = acquire();
+	sqe->opcode	= IORING_OP_PROVIDE_BUFFERS;
+	sqe->flags	= IOSQE_CQE_SKIP_SUCCESS;
+	sqe->fd		= 1;		/* the number of buffers */
+	sqe->addr	= reinterpret_cast<uint64_t>(bufMemory.data() + size_t(bid) * bufSize);
+	sqe->len	= bufSize;
+	sqe->off	= bid;
+	sqe->buf_group	= 0;
+	commit();
+	return;
+    }
+
+    /* Indexed by hand: under C++ the header's flexible 'bufs' member	*/
+    /* lands at offset 8, not 0 where the kernel puts the entries.	*/
+    struct io_uring_buf	*buf = reinterpret_cast<struct io_uring_buf *>(bufRing)
+	+ (bufTail & (bufCount - 1));
+
+    buf->addr	= reinterpret_cast<uint64_t>(bufMemory.data() + size_t(bid) * bufSize);
+    buf->len	= bufSize;
+    buf->bid	= bid;
+    bufTail++;
+    __atomic_store_n(&bufRing->tail, bufTail, __ATOMIC_RELEASE);
+}
+
+auto JSNSockRing::release(
+	operation	*op
+	)		-> void
+{
+    auto range = operations.equal_range(op->fd);
+
+    for (auto it = range.first; it != range.second; ++it)
+	if (it->second == op)
+	{
+	    operations.erase(it);
+	    break;
+	}
+
+    /* A cancel queued for this record may not have been submitted yet;	*/
+    /* freeing it now could let a new record take its address.		*/
+    retired.push_back(op);
+}
+
+auto JSNSockRing::reap(
+	size_t		count
+	)		-> void
+{
+    for (size_t i = 0; i < count; i++)
+	delete retired[i];
+    retired.erase(retired.begin(), retired.begin() + count);
+}
+
+auto JSNSockRing::accept(
+	int		listenDesc,
+	completion	handler
+	)		-> void
+{
+    operation	*op = new operation { acceptor, listenDesc, true, std::move(handler), nullptr, std::string(), 0 };
+
+    operations.emplace(listenDesc, op);
+    arm(op);
+}
+
+auto JSNSockRing::recv(
+	int		fd,
+	receiver	handler
+	)		-> void
+{
+    operation	*op = new operation { reader, fd, true, nullptr, std::move(handler), std::string(), 0 };
+
+    operations.emplace(fd, op);
+    arm(op);
+}
+
+auto JSNSockRing::send(
+	int		fd,
+	std::string	data,
+	completion	handler
+	)		-> void
+{
+    if (data.empty())
+    {
+	if (handler)
+	    handler(0);
+	return;
+    }
+
+    operation	*op = new operation { writer, fd, true, std::move(handler), nullptr, std::move(data), 0 };
+
+    operations.emplace(fd, op);
+    arm(op);
+}
+
+auto JSNSockRing::cancel(
+	int		fd
+	)		-> void
+{
+    auto range = operations.equal_range(fd);
+
+    /* Cancels are matched by record, not descriptor, so they work after	*/
+    /* 'fd' is closed.  Submissions are issued in queue order, so an	*/
+    /* operation queued earlier in the same batch is found as well.	*/
+    for (auto it = range.first; it != range.second; ++it)
+    {
+	if (!it->second->live)
+	    continue;
+	it->second->live = false;
+
+	struct io_uring_sqe *sqe = acquire();
+	sqe->opcode	= IORING_OP_ASYNC_CANCEL;
+	sqe->addr	= reinterpret_cast<uint64_t>(it->second);
+	commit();
+
+	if (it->second->type == acceptor)	/* or its backoff, if paused */
+	{
+	    sqe = acquire();
+	    sqe->opcode	= IORING_OP_ASYNC_CANCEL;
+	    sqe->addr	= reinterpret_cast<uint64_t>(it->second) | resuming;
+	    commit();
+	}
+    }
+} /* JSNSockRing::cancel */
+
+auto JSNSockRing::complete(
+	const struct io_uring_cqe	&cqe
+	)				-> bool
+{
+    operation	*op = reinterpret_cast<operation *>(cqe.user_data & ~resuming);
+    bool	more = cqe.flags & IORING_CQE_F_MORE;	/* a multishot request is still armed */
+    bool	dispatched = false;
+
+    if (op == nullptr)	/* a cancel request's own completion */
+	return false;
+
+    if (cqe.user_data & resuming)	/* a paused accept's timeout, fired or cancelled */
+    {
+	if (op->live)
+	    arm(op);
+	else
+	    release(op);
+	return false;
+    }
+
+    switch (op->type)
+    {
+	case acceptor:
+	    if (op->live && cqe.res != -ECANCELED)
+	    {
+		op->done(cqe.res);
+		dispatched = true;
+	    }
+	    else if (cqe.res >= 0)	/* accepted after cancellation */
+		::close(cqe.res);
+
+	    if (!more)
+	    {
+		/* Out of descriptors or memory: re-armed at once, the accept	*/
+		/* would fail again straight away, so wait for some to free.	*/
+		/* ECANCELED on a live record: the submitting thread exited.	*/
+		if (!op->live || cqe.res == -EBADF || cqe.res == -EINVAL)
+		    release(op);
+		else if (cqe.res == -EMFILE || cqe.res == -ENFILE || cqe.res == -ENOMEM)
+		    pause(op);
+		else
+		    arm(op);
+	    }
+	    break;
+
+	case reader:
+	    if (cqe.flags & IORING_CQE_F_BUFFER)
+	    {
+		uint16_t	bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+
+		if (op->live && cqe.res > 0)
+		{
+		    op->data(JSNSockView { bufMemory.data() + size_t(bid) * bufSize, size_t(cqe.res) }, 0);
+		    dispatched = true;
+		}
+		recycle(bid);
+	    }
+	    else if (op->live && cqe.res != -ENOBUFS && cqe.res != -ECANCELED)
+	    {
+		/* end of stream (0) or an error */
+		op->data(JSNSockView { nullptr, 0 }, cqe.res < 0 ? -cqe.res : 0);
+		op->live = false;
+		dispatched = true;
+	    }
+
+	    if (!more)
+	    {
+		/* the kernel ends a multishot receive when it runs out of	*/
+		/* buffers; the buffers are back by now, so re-arm it		*/
+		if (op->live && (cqe.res > 0 || cqe.res == -ENOBUFS || cqe.res == -ECANCELED))
+		    arm(op);
+		else
+		    release(op);
+	    }
+	    break;
+
+	case writer:
+	    if (cqe.res > 0 && (op->sent += cqe.res) < op->output.size() && op->live)
+	    {
+		arm(op);	/* short send: the rest, from where it stopped */
+		break;
+	    }
+
+	    if (op->live && op->done)
+	    {
+		op->done(cqe.res < 0 ? cqe.res : static_cast<int>(op->sent));
+		dispatched = true;
+	    }
+	    release(op);
+	    break;
+
+	case waker:
+	    uint64_t	count;
+	    while (::read(wakeDesc, &count, sizeof(count)) > 0)
+		;
+	    if (!more && ringDesc != -1)
+		arm(op);
+	    break;
+    }
+
+    return dispatched;
+} /* JSNSockRing::complete */
+
+auto JSNSockRing::poll(
+	int		timeout
+	)		-> uint32_t
+{
+    uint32_t	dispatched = 0;
+    unsigned	head = *cqHead;
+    size_t	reapable = retired.size();
+
+    /* One system call both submits the queued batch and, if nothing has	*/
+    /* completed yet, waits for the first completion.			*/
+    if (loadAcquire(cqTail) == head)
+	enter(queued, timeout == 0 ? 0 : 1, timeout);
+    else if (queued)
+	enter(queued, 0, 0);
+
+    if (queued == 0)
+	reap(reapable);
+
+    for (unsigned tail = loadAcquire(cqTail); head != tail; tail = loadAcquire(cqTail))
+    {
+	while (head != tail)
+	{
+	    struct io_uring_cqe	cqe = cqes[head & cqMask];
+
+	    storeRelease(cqHead, ++head);	/* copied out: the slot may be reused */
+	    if (complete(cqe))
+		dispatched++;
+	}
+    }
+
+    return dispatched;
+} /* JSNSockRing::poll */
+
+auto JSNSockRing::run(
+	)		-> void
+{
+    while (!stopped)
+	poll();
+    stopped = false;	/* a stopped ring may be run again */
+}
+
+auto JSNSockRing::stop(
+	)		-> void
+{
+    uint64_t	one = 1;
+
+    stopped = true;
+    if ( ::write(wakeDesc, &one, sizeof(one)) == -1 && errno != EAGAIN )
+	throw JSNException("JSNSockRing: unable to wake the event loop.");
+}
@@ -0,0 +1,213 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+/* Includes */
+#include "JSNSockSendQueue.hpp"
+#include <sys/eventfd.h>
+#include <algorithm>
+#include <climits>	/* IOV_MAX */
+#include <cstring>
+#include <sys/socket.h>	/* used for 'shutdown(2)' */
+#include <unistd.h>	/* used for 'close(2)', 'read(2)' and 'write(2)' */
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+JSNSockSendQueue::JSNSockSendQueue(
+	JSNSockTCP	&socket
+	)
+: socket(socket), top(nullptr)
+{
+    if ( (wakeDesc = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1 )
+	throw JSNException("JSNSockSendQueue: unable to create a wake-up eventfd.");
+}
+
+JSNSockSendQueue::~JSNSockSendQueue()
+{
+    node	*n = top.exchange(nullptr, std::memory_order_acquire);
+
+    while (n != nullptr)
+    {
+	node	*next = n->next;
+	delete n;
+	n = next;
+    }
+
+    detach();
+    ::close(wakeDesc);
+}
+
+auto JSNSockSendQueue::push(
+	std::string	data
+	)		-> void
+{
+    node	*n = new node { std::move(data), nullptr };
+    node	*head = top.load(std::memory_order_relaxed);
+    uint64_t	one = 1;
+
+    /* Only whole stacks are ever taken, so a node is never popped	*/
+    /* alone and the compare-exchange cannot suffer ABA.		*/
+    do
+	n->next = head;
+    while (!top.compare_exchange_weak(head, n,
+		std::memory_order_release, std::memory_order_relaxed));
+
+    /* The first push after a drain wakes the owner; later ones ride along */
+    if (head == nullptr)
+	while (::write(wakeDesc, &one, sizeof(one)) == -1 && errno == EINTR)
+	    ;
+}
+
+auto JSNSockSendQueue::take(
+	)		-> void
+{
+    uint64_t	count;
+    node	*n;
+    size_t	start = unsent.size();
+
+    /* Clear the wake-up first: a push after the exchange wakes again */
+    while (::read(wakeDesc, &count, sizeof(count)) == -1 && errno == EINTR)
+	;
+
+    n = top.exchange(nullptr, std::memory_order_acquire);
+    while (n != nullptr)	/* newest first: reversed below */
+    {
+	node	*next = n->next;
+	unsent.push_back(std::move(n->data));
+	delete n;
+	n = next;
+    }
+    std::reverse(unsent.begin() + start, unsent.end());
+} /* JSNSockSendQueue::take */
+
+auto JSNSockSendQueue::drain(
+	)		-> size_t
+{
+    struct iovec	iov[IOV_MAX];
+    struct msghdr	msg;
+    ssize_t		bytesSent;
+    size_t		total = 0;
+    size_t		offered;
+    int			count;
+
+    take();
+    while (!unsent.empty())
+    {
+	count	= 0;
+	offered	= 0;
+	for (auto it = unsent.begin(); it != unsent.end() && count < IOV_MAX; ++it)
+	{
+	    iov[count].iov_base	= const_cast<char *>(it->data()) + (count == 0 ? offset : 0);
+	    iov[count].iov_len	= it->size() - (count == 0 ? offset : 0);
+	    offered += iov[count].iov_len;
+	    count++;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov	= iov;
+	msg.msg_iovlen	= count;
+
+	if ( (bytesSent = ::sendmsg(socket.descriptor(), &msg,
+			MSG_DONTWAIT | MSG_NOSIGNAL)) == -1 )
+	{
+	    if (errno == EINTR)
+		continue;
+	    if (errno == EAGAIN || errno == EWOULDBLOCK)
+	    {
+		socket.counters.add(JSNSockCounters::wouldBlock);
+		break;	/* the rest waits for writability */
+	    }
+	    throw JSNException("JSNSockSendQueue: exception during attempt to send data.");
+	}
+
+	socket.counters.add(JSNSockCounters::sends);
+	socket.counters.add(JSNSockCounters::bytesSent, bytesSent);
+	if (size_t(bytesSent) < offered)
+	    socket.counters.add(JSNSockCounters::partialWrites);
+	total += bytesSent;
+	offset += bytesSent;
+	while (!unsent.empty() && offset >= unsent.front().size())
+	{
+	    offset -= unsent.front().size();
+	    unsent.pop_front();
+	}
+
+	if (unsent.empty())	/* pick up whatever was pushed meanwhile */
+	    take();
+    }
+
+    return total;
+} /* JSNSockSendQueue::drain */
+
+auto JSNSockSendQueue::attach(
+	JSNSockReactor	&reactor
+	)		-> void
+{
+    this->reactor = &reactor;
+    reactor.add(wakeDesc, JSNSockReactor::readable,
+	    [this](uint32_t /* events */)
+	    {
+		pump();
+	    });
+
+    /* through the socket's own registration, merged with its owner's */
+    watchToken = reactor.watch(socket.descriptor(), JSNSockReactor::writable,
+	    [this](uint32_t /* events */)
+	    {
+		if (!unsent.empty())	/* left over by an EAGAIN */
+		    pump();
+	    });
+}
+
+auto JSNSockSendQueue::pump(
+	)		-> void
+{
+    try
+    {
+	drain();
+    }
+    catch (JSNException &e)
+    {
+	failure = e.code();
+	JSN_LOG(warning, "JSNSockSendQueue: socket descriptor (%d) dropped with %zu message(s) unsent: %s",
+		socket.descriptor(), unsent.size(), e.what());
+
+	detach();
+	unsent.clear();
+	offset = 0;
+
+	/* the owner sees a hangup and closes the socket on its own path */
+	::shutdown(socket.descriptor(), SHUT_RDWR);
+    }
+} /* JSNSockSendQueue::pump */
+
+auto JSNSockSendQueue::detach(
+	)		-> void
+{
+    if (reactor != nullptr)
+    {
+	reactor->remove(wakeDesc);
+	reactor->unwatch(watchToken);	/* nothing if the socket was removed */
+	reactor = nullptr;
+    }
+}
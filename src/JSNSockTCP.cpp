@@ -22,9 +22,18 @@
 
 /** Includes **/
 #include "JSNSock.hpp"
-#include <sys/select.h>
 #include <sys/types.h>
+#include <netinet/tcp.h>	/* TCP_CORK */
+#include <limits.h>	/* IOV_MAX */
+#include <sys/sendfile.h>
+#include <sys/stat.h>	/* used for 'fstat' in sendFile */
+#include <fcntl.h>	/* used for 'splice' */
+#include <poll.h>
+#include <linux/errqueue.h>	/* struct sock_extended_err */
+#include <string.h>
 #include <sstream>
+#include <memory>
+#include <algorithm>
 
 /** Using **/
 using namespace jsnSock;
@@ -48,7 +57,9 @@ JSNSockTCP::JSNSockTCP(	/* Constructor 1/2 */
     domain		= domain::inet;
     type		= type::stream;
     protocol		= protocol::tcp;
-    this->timeout	= timeout;
+    this->timeout	= 0.0;
+
+    setTimeout(timeout);	/* a timed socket is switched to non-blocking once, here */
 }
 
 JSNSockTCP::JSNSockTCP(	/* Constructor 2/2 */
@@ -61,43 +72,283 @@ JSNSockTCP::JSNSockTCP(	/* Constructor 2/2 */
     connect(host, port);
 }
 
-auto JSNSockTCP::select(
+JSNSockTCP::~JSNSockTCP()
+{
+    int		error;
+
+    /* Best effort and never blocking: there is no one to tell, and what	*/
+    /* the kernel will not take at once is dropped.			*/
+    if (!sendBuffer.empty() && valid())
+	sendBuffered(clock::now(), error, MSG_DONTWAIT);
+}
+
+auto JSNSockTCP::close(
 	)		-> void
 {
-	int selectSays;
+    int		error;
+
+    /* As in the destructor; an explicit 'flush' waits and reports */
+    if (!sendBuffer.empty() && valid())
+	sendBuffered(clock::now(), error, MSG_DONTWAIT);
+    JSNSockBase::close();
+}
+
+auto JSNSockTCP::operator=(
+	JSNSockTCP	&&other
+	)		-> JSNSockTCP &
+{
+    int		error;
+
+    if (this != &other)
+    {
+	/* The socket being replaced is closed: as in 'close' */
+	if (!sendBuffer.empty() && valid())
+	    sendBuffered(clock::now(), error, MSG_DONTWAIT);
+
+	JSNSockBase::operator=(std::move(other));
+	recvBuffer		= std::move(other.recvBuffer);
+	sendBuffer		= std::move(other.sendBuffer);
+	sendThreshold		= other.sendThreshold;
+	zeroCopy		= other.zeroCopy;
+	zeroCopyThreshold	= other.zeroCopyThreshold;
+	zeroCopyNext		= other.zeroCopyNext;
+	zeroCopyPending		= std::move(other.zeroCopyPending);
+    }
+
+    return *this;
+}
+
+auto JSNSockTCP::connectTo (
+	const JSNSockAddress	&address,
+	clock::time_point	limit
+	)			-> void
+{
+    int		error;
 
-	do
+    connectTo(address, limit, error);
+    if (error)
+    {
+	errno = error;
+	throw JSNException(error == ETIMEDOUT ? "JSNSockTCP::connect : connection timed-out."
+					      : "JSNSockTCP::connect : connection exception.");
+    }
+} /* JSNSockTCP::connectTo */
+
+auto JSNSockTCP::connectTo (
+	const JSNSockAddress	&address,
+	clock::time_point	limit,
+	int			&error
+	)			-> void
+{
+    error = 0;
+
+    if ( static_cast<int>(domain) != address.family() || !valid() )
+    {
+	int	fd = ::socket(address.family(),
+		type | SOCK_CLOEXEC | (timeout != 0.0 ? SOCK_NONBLOCK : 0), protocol);
+
+	if (fd == -1)
 	{
-	    struct timeval tv;
-	    fd_set set;
+	    error = errno;
+	    return;
+	}
+	adopt(fd);
+	domain = address.family();
+    }
 
-	    tv.tv_sec	= (int)timeout;
-	    tv.tv_usec	= (int)( (timeout * 1000) - (double)(tv.tv_sec *1000) ); /* regain precision lost after cast to int */
-	    
-	    FD_ZERO(&set);
-	    FD_SET(sockDesc, &set);
+    if ( ::connect(sockDesc, address.sockaddr(), address.length) == -1)
+    {
+	if (errno == EINPROGRESS || errno == EINTR)	/* completes in the background */
+	{
+	    socklen_t	length = sizeof(error);
+
+	    if ( (error = waitFor(POLLOUT, limit)) == 0 )
+		::getsockopt(sockDesc, SOL_SOCKET, SO_ERROR, &error, &length);
+	}
+	else
+	    error = errno;
+    }
+} /* JSNSockTCP::connectTo (const JSNSockAddress &, clock::time_point, int &) */
+
+auto JSNSockTCP::connectRace (
+	JSNSockResolver::addresses	&candidates,
+	clock::time_point		limit
+	)				-> void
+{
+    std::vector<struct pollfd>	inflight;
+    std::vector<int>		families;
+    size_t			next = 0;
+    int				winner = invalid;
+    int				lastError = ECONNREFUSED;
+    clock::time_point		nextStart = clock::now();
+    clock::duration		stagger = std::chrono::duration_cast<clock::duration>(
+					std::chrono::duration<double>(JSN_CONNECT_STAGGER));
+
+    /* the existing socket takes the first candidate of its own family,	*/
+    /* so options set on it before connect are kept when it wins.	*/
+    bool			ownUsed = !valid();
+
+    /* on failure: close every attempt but our own, which is left as found */
+    auto abandon = [this, &inflight, &ownUsed](
+	    )
+    {
+	int	saved = errno;
+
+	for (struct pollfd &attempt : inflight)
+	    if (attempt.fd != sockDesc)
+		::close(attempt.fd);
+	if (ownUsed && valid() && timeout == 0.0)
+	    setBlocking(true);
+	errno = saved;
+    }; /* abandon */
+
+    while (winner == invalid)
+    {
+	clock::time_point	now = clock::now();
+
+	if (next < candidates.size() && (inflight.empty() || now >= nextStart))
+	{
+	    const JSNSockAddress	&address = candidates[next++];
+	    int				fd;
 
-	    if ((selectSays = ::select(sockDesc+1, NULL, &set, NULL, &tv)) == -1)
+	    if (!ownUsed && address.family() == static_cast<int>(domain))
 	    {
-		if (errno == EINTR)
-		{
-		    throw JSNException("JSNSockTCP: connection interupted.");
-		}
-		else
-		{
-		    throw JSNException("JSNSockTCP: check timeout sanity and check file descriptors.");
-		}
+		fd = sockDesc;
+		ownUsed = true;
+		if (timeout == 0.0)
+		    setBlocking(false);
 	    }
-	    else if (selectSays) /* true if value greater than zero */
+	    else if ( (fd = ::socket(address.family(), type | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol)) == -1 )
 	    {
-		break;
+		lastError = errno;
+		continue;
+	    }
+
+	    int		result = ::connect(fd, address.sockaddr(), address.length);
+
+	    if (result == 0 || errno == EINPROGRESS)
+	    {
+		inflight.push_back(pollfd { fd, POLLOUT, 0 });
+		families.push_back(address.family());
+		nextStart = now + stagger;
+		if (result == 0)	/* connected at once (loopback); it is last in 'inflight' */
+		    winner = fd;
+	    }
+	    else
+	    {
+		lastError = errno;
+		if (fd != sockDesc)
+		    ::close(fd);
+	    }
+	    continue;
+	}
+
+	if (inflight.empty())	/* every candidate failed outright */
+	{
+	    abandon();
+	    errno = lastError;
+	    throw JSNException("JSNSockTCP::connect : connection exception.");
+	}
+
+	if (now >= limit)
+	{
+	    abandon();
+	    errno = ETIMEDOUT;
+	    throw JSNException("JSNSockTCP::connect : connection timed-out.");
+	}
+
+	/* sleep until an attempt completes, the next one is due or time is up */
+	clock::time_point	until = (next < candidates.size()) ? std::min(nextStart, limit) : limit;
+	int			wait = (until == clock::time_point::max()) ? -1 :
+	    static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+			until - now + std::chrono::microseconds(999)).count());
+
+	if (::poll(inflight.data(), inflight.size(), wait) == -1 && errno != EINTR)
+	{
+	    abandon();
+	    throw JSNException("JSNSockTCP::connect : poll exception.");
+	}
+
+	for (size_t i = 0; i < inflight.size() && winner == invalid; )
+	{
+	    if (!inflight[i].revents)
+	    {
+		i++;
+		continue;
+	    }
+
+	    int		error = 0;
+	    socklen_t	length = sizeof(error);
+
+	    getsockopt(inflight[i].fd, SOL_SOCKET, SO_ERROR, &error, &length);
+	    if (error == 0)
+	    {
+		winner = inflight[i].fd;
+		std::swap(inflight[i], inflight.back());
+		std::swap(families[i], families.back());
 	    }
 	    else
 	    {
-		throw JSNException("JSNSockTCP: connection timed-out.");
+		lastError = error;
+		if (inflight[i].fd != sockDesc)
+		    ::close(inflight[i].fd);
+		inflight.erase(inflight.begin() + i);
+		families.erase(families.begin() + i);
 	    }
 	}
-	while (1);
+    }
+
+    /* the winner is last in 'inflight'; abandon the rest */
+    for (size_t i = 0; i + 1 < inflight.size(); i++)
+	if (inflight[i].fd != sockDesc)
+	    ::close(inflight[i].fd);
+
+    if (winner != sockDesc)
+    {
+	adopt(winner);
+	domain = families.back();
+    }
+
+    if (timeout == 0.0)
+	setBlocking(true);	/* raced non-blocking; an untimed socket blocks */
+} /* JSNSockTCP::connectRace */
+
+auto JSNSockTCP::candidates (
+	const std::string	&host,
+	uint16_t		port
+	)			-> JSNSockResolver::addresses
+{
+    /* cached names skip DNS entirely; the lookup shares the timeout */
+    JSNSockResolver::addresses	found = JSNSockResolver::shared().resolve(host, AF_UNSPEC, timeout);
+    JSNSockResolver::addresses	ordered;
+
+    /* interleave the families, starting with the resolver's first choice */
+    for (size_t a = 0, b = 0; ordered.size() < found.size(); )
+    {
+	while (a < found.size() && found[a].family() != found[0].family())
+	    a++;
+	while (b < found.size() && found[b].family() == found[0].family())
+	    b++;
+	if (a < found.size())
+	    ordered.push_back(found[a++]);
+	if (b < found.size())
+	    ordered.push_back(found[b++]);
+    }
+
+    for (JSNSockAddress &address : ordered)
+	address.setPort(port);
+
+    return ordered;
+} /* JSNSockTCP::candidates */
+
+auto JSNSockTCP::connected (
+	clock::time_point	started
+	)			-> void
+{
+    counters.add(JSNSockCounters::connects);
+    if (started != clock::time_point())
+	JSNSockMetrics::record(JSNSockMetrics::connectTime,
+		std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - started).count());
 }
 
 auto JSNSockTCP::connect (
@@ -105,206 +356,756 @@ auto JSNSockTCP::connect (
 	uint16_t		port
 	)			-> void
 {
-    struct sockaddr_in	sockAddr;
+    clock::time_point		limit = deadline();
+    JSNSockResolver::addresses	found = candidates(host, port);
+    clock::time_point		started = JSNSockMetrics::enabled() ? clock::now() : clock::time_point();
 
-    sockAddr.sin_family		= domain;
-    sockAddr.sin_port		= htons(port);
-    sockAddr.sin_addr.s_addr	= inet_addr( getHostByName(host).c_str() );
+    if (found.size() == 1)
+	connectTo(found.front(), limit);
+    else
+	connectRace(found, limit);
 
-    if (timeout == 0.0)
+    connected(started);
+} /* JSNSockTCP::connect */
+
+auto JSNSockTCP::connect (
+	const std::string	&host,
+	uint16_t		port,
+	std::error_code		&error
+	)			-> void
+{
+    clock::time_point		limit = deadline();
+    JSNSockResolver::addresses	found;
+    clock::time_point		started;
+    int				code = 0;
+
+    error.clear();
+
+    /* a failed lookup or a lost race still unwinds internally; the	*/
+    /* common single-address connect does not				*/
+    try
+    {
+	found = candidates(host, port);
+    }
+    catch (JSNException &e)
+    {
+	error.assign(e.code(), std::system_category());
+	return;
+    }
+
+    started = JSNSockMetrics::enabled() ? clock::now() : clock::time_point();
+    if (found.size() == 1)
+	connectTo(found.front(), limit, code);
+    else
     {
-	if ( ::connect(sockDesc, (struct sockaddr *) &sockAddr, sizeof(struct sockaddr)) == -1)
+	try
 	{
-	    throw JSNException("JSNSockTCP::connect : connection exception.");
+	    connectRace(found, limit);
+	}
+	catch (JSNException &e)
+	{
+	    code = e.code();
 	}
     }
+
+    if (code)
+	error.assign(code, std::system_category());
     else
+	connected(started);
+} /* JSNSockTCP::connect (const std::string &, uint16_t, std::error_code &) */
+
+auto JSNSockTCP::sendSome(
+	const struct iovec	*buffers,
+	int			count,
+	int			flags,
+	clock::time_point	limit
+	)			-> size_t
+{
+    int		error;
+    size_t	bytesSent = sendSome(buffers, count, flags, limit, error);
+
+    if (error)
+    {
+	errno = error;
+	throw JSNException(error == ETIMEDOUT ? "JSNSockBase: operation timed-out."
+					      : "JSNSockTCP: exception during attempt to send data.");
+    }
+
+    return bytesSent;
+} /* JSNSockTCP::sendSome (const struct iovec *, int, int, clock::time_point) -> size_t */
+
+auto JSNSockTCP::sendSome(
+	const struct iovec	*buffers,
+	int			count,
+	int			flags,
+	clock::time_point	limit,
+	int			&error
+	)			-> size_t
+{
+    struct msghdr	msg;
+    ssize_t		bytesSent;
+    size_t		offered = 0;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov		= const_cast<struct iovec *>(buffers);
+    msg.msg_iovlen	= count;
+    flags		|= MSG_NOSIGNAL;	/* a reset peer is reported, not signalled */
+    error		= 0;
+
+    for (int i = 0; i < count; i++)
+	offered += buffers[i].iov_len;
+
+    while ( (bytesSent = ::sendmsg(sockDesc, &msg, flags)) == -1 )
+    {
+	if (errno == EINTR)
+	    continue;
+
+	error = errno;
+	if (error == EAGAIN)
+	    counters.add(JSNSockCounters::wouldBlock);
+	if (error != EAGAIN || timeout == 0.0 ||
+		(error = waitFor(POLLOUT, limit, JSNSockMetrics::sendWait)) != 0)
+	    return 0;
+    }
+
+    counters.add(JSNSockCounters::sends);
+    counters.add(JSNSockCounters::bytesSent, bytesSent);
+    if (size_t(bytesSent) < offered)
+	counters.add(JSNSockCounters::partialWrites);
+
+    return bytesSent;
+} /* JSNSockTCP::sendSome (const struct iovec *, int, int, clock::time_point, int &) -> size_t */
+
+auto JSNSockTCP::sendv(
+	const struct iovec	*buffers,
+	int			count,
+	bool			more
+	)			-> void
+{
+    int			flags = more ? MSG_MORE : 0;
+    clock::time_point	limit = deadline();	/* one deadline for the whole list */
+
+    if (!sendBuffer.empty())	/* keep operator<< output ahead of this */
+	flush();
+
+    while (count > 0)
     {
-	setBlocking(false);
-	if ( ::connect(sockDesc, (struct sockaddr *) &sockAddr, sizeof(struct sockaddr)) == -1)
+	size_t	bytesSent = sendSome(buffers, std::min(count, IOV_MAX), flags, limit);
+
+	/* skip the buffers that went out whole */
+	while (count > 0 && bytesSent >= buffers->iov_len)
 	{
-	    if (errno == EAGAIN)
-	    {
-		select();
-	    }
-	    else
+	    bytesSent -= buffers->iov_len;
+	    buffers++;
+	    count--;
+	}
+
+	/* finish a partially sent buffer on its own; the caller's array is const */
+	if (count > 0 && bytesSent > 0)
+	{
+	    struct iovec	rest;
+	    rest.iov_base	= static_cast<char *>(buffers->iov_base) + bytesSent;
+	    rest.iov_len	= buffers->iov_len - bytesSent;
+
+	    while (rest.iov_len > 0)
 	    {
-		JSNException("JSNSockTCP: connection exception.");
+		bytesSent	= sendSome(&rest, 1, (count > 1) ? MSG_MORE : flags, limit);
+		rest.iov_base	= static_cast<char *>(rest.iov_base) + bytesSent;
+		rest.iov_len	-= bytesSent;
 	    }
+	    buffers++;
+	    count--;
 	}
-	setBlocking(true);
     }
-} /* JSNSockTCP::connect */
+} /* JSNSockTCP::sendv (const struct iovec *, int, bool) */
+
+auto JSNSockTCP::sendAll(
+	const void	*buffer,
+	size_t		size,
+	bool		more
+	)		-> void
+{
+    struct iovec	iov;
+    iov.iov_base	= const_cast<void *>(buffer);
+    iov.iov_len		= size;
+
+    sendv(&iov, 1, more);
+}
 
 auto JSNSockTCP::send(
 	const std::string	&buffer
 	)			-> void
 {
-    if (timeout == 0.0)
+    sendAll(buffer.data(), buffer.length());
+} /* JSNSockTCP::send(const std::string &) */
+
+auto JSNSockTCP::send(
+	const void	*buffer,
+	uint32_t	size
+	)		-> void
+{
+    sendAll(buffer, size);
+} /* JSNSockTCP::send(const void *buffer, uint32_t size) */
+
+auto JSNSockTCP::send(
+	const void	*buffer,
+	size_t		size,
+	std::error_code	&error
+	)		-> size_t
+{
+    struct iovec	rest;
+    clock::time_point	limit = deadline();
+    size_t		bytesSent = 0;
+    int			code = 0;
+
+    rest.iov_base	= const_cast<void *>(buffer);
+    rest.iov_len	= size;
+
+    if (!sendBuffer.empty())
+	sendBuffered(limit, code);
+
+    while (rest.iov_len > 0 && code == 0)
+    {
+	size_t	chunk = sendSome(&rest, 1, 0, limit, code);
+
+	rest.iov_base	= static_cast<char *>(rest.iov_base) + chunk;
+	rest.iov_len	-= chunk;
+	bytesSent	+= chunk;
+    }
+
+    if (code)
+	error.assign(code, std::system_category());
+    else
+	error.clear();
+
+    return bytesSent;
+} /* JSNSockTCP::send (const void *, size_t, std::error_code &) -> size_t */
+
+auto JSNSockTCP::sendFile(
+	int		fd,
+	off_t		offset,
+	size_t		length
+	)		-> size_t
+{
+    size_t		bytesSent = 0;
+    ssize_t		chunk;
+    clock::time_point	limit = deadline();
+
+    flush();	/* operator<< output goes first */
+
+    if (length == 0)
     {
-	if ( ::send(sockDesc, buffer.c_str(), buffer.length(), 0) == -1 )
+	struct stat	info;
+	if (fstat(fd, &info) == -1)
+	    throw JSNException("JSNSockTCP: sendFile unable to stat the file.");
+	if (info.st_size <= offset)
+	    return 0;
+	length = info.st_size - offset;
+    }
+
+    while (bytesSent < length)
+    {
+	/* sendfile(2) advances 'offset' by what it sent */
+	if ( (chunk = ::sendfile(sockDesc, fd, &offset, std::min<size_t>(length - bytesSent, 0x7ffff000))) == -1)
+	{
+	    if (errno == EINTR)
+		continue;
+	    else if (errno == EAGAIN && timeout != 0.0)
+	    {
+		counters.add(JSNSockCounters::wouldBlock);
+		wait(POLLOUT, limit, JSNSockMetrics::sendWait);
+	    }
+	    else
+		throw JSNException("JSNSockTCP: exception during attempt to send a file.");
+	}
+	else if (chunk == 0)	/* the file is shorter than 'length' */
+	    break;
+	else
 	{
-	    throw JSNException("JSNSockTCP: exception during attempt to send data.");
+	    counters.add(JSNSockCounters::sends);
+	    counters.add(JSNSockCounters::bytesSent, chunk);
+	    bytesSent += chunk;
 	}
     }
-    else
+
+    return bytesSent;
+} /* JSNSockTCP::sendFile (int, off_t, size_t) -> size_t */
+
+auto JSNSockTCP::sendPipe(
+	int		pipeDesc,
+	size_t		length
+	)		-> size_t
+{
+    size_t		bytesSent = 0;
+    ssize_t		chunk;
+    clock::time_point	limit = deadline();
+
+    flush();	/* operator<< output goes first */
+
+    while (bytesSent < length)
     {
-	setBlocking(false);
-	if ( ::send(sockDesc, buffer.c_str(), buffer.length(), 0) == -1 )
+	if ( (chunk = ::splice(pipeDesc, nullptr, sockDesc, nullptr, length - bytesSent,
+			SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) == -1)
 	{
-	    if (errno == EAGAIN)
+	    if (errno == EINTR)
+		continue;
+	    else if (errno != EAGAIN)
+		throw JSNException("JSNSockTCP: exception during attempt to splice a pipe.");
+
+	    /* Either end may be the one that would block.  An empty pipe	*/
+	    /* is waited for until 'limit' (its writer is behind); a full	*/
+	    /* socket only when timed, as in 'send'.			*/
+	    if (waitFor(pipeDesc, POLLIN, clock::now()) == ETIMEDOUT)
 	    {
-		select();
+		if ( (errno = waitFor(pipeDesc, POLLIN, limit)) == ETIMEDOUT )
+		    throw JSNException("JSNSockBase: operation timed-out.");
+		else if (errno != 0)
+		    throw JSNException("JSNSockBase: poll exception; check file descriptors.");
+	    }
+	    else if (timeout != 0.0)
+	    {
+		counters.add(JSNSockCounters::wouldBlock);
+		wait(POLLOUT, limit, JSNSockMetrics::sendWait);
 	    }
 	    else
 	    {
-		JSNException("JSNSockTCP: exception during an attempt to send data.");
+		errno = EAGAIN;
+		throw JSNException("JSNSockTCP: exception during attempt to splice a pipe.");
 	    }
 	}
-	setBlocking(true);
+	else if (chunk == 0)	/* all writers closed the pipe */
+	    break;
+	else
+	{
+	    counters.add(JSNSockCounters::sends);
+	    counters.add(JSNSockCounters::bytesSent, chunk);
+	    bytesSent += chunk;
+	}
     }
-} /* JSNSockTCP::send(const std::string &) */
 
-auto JSNSockTCP::send(
+    return bytesSent;
+} /* JSNSockTCP::sendPipe (int, size_t) -> size_t */
+
+auto JSNSockTCP::setZeroCopy(
+	bool		on,
+	size_t		threshold
+	)		-> void
+{
+    int		value = on ? 1 : 0;
+
+    setSockOption(SOL_SOCKET, SO_ZEROCOPY, &value, sizeof(value));
+    zeroCopy		= on;
+    zeroCopyThreshold	= threshold;
+}
+
+auto JSNSockTCP::sendZeroCopy(
 	const void	*buffer,
-	uint32_t	size
+	size_t		size,
+	completion	done
 	)		-> void
 {
-    if (timeout == 0.0)
+    flush();	/* operator<< output goes first */
+
+    if (!zeroCopy || size < zeroCopyThreshold)
     {
-	if ( ::send(sockDesc, buffer, size, 0) == -1 )
-	{
-	    throw JSNException("JSNSockTCP: exception during attempt to send binary data.");
-	}
+	sendAll(buffer, size);
+	if (done)
+	    done();
+	return;
     }
-    else
+
+    const char		*cursor = static_cast<const char *>(buffer);
+    size_t		remaining = size;
+    bool		numbered = false;	/* did any send get a notification id? */
+    ssize_t		bytesSent;
+    clock::time_point	limit = deadline();
+
+    while (remaining > 0)
     {
-	setBlocking(false);
-	if ( ::send(sockDesc, buffer, size, 0) == -1 )
+	if ( (bytesSent = ::send(sockDesc, cursor, remaining, MSG_ZEROCOPY | MSG_NOSIGNAL)) == -1)
 	{
-	    if (errno == EAGAIN)
+	    if (errno == EINTR)
+		continue;
+	    else if (errno == EAGAIN && timeout != 0.0)
 	    {
-		select();
+		counters.add(JSNSockCounters::wouldBlock);
+		wait(POLLOUT, limit, JSNSockMetrics::sendWait);
 	    }
-	    else
+	    else if (errno == ENOBUFS)	/* out of pinned-page budget: copy the rest */
 	    {
-		JSNException("JSNSockTCP: exception during an attempt to send binary data.");
+		sendAll(cursor, remaining);
+		remaining = 0;
 	    }
+	    else
+		throw JSNException("JSNSockTCP: exception during attempt to send zero-copy data.");
+	}
+	else
+	{
+	    zeroCopyNext++;	/* the kernel numbers every successful zero-copy send */
+	    numbered = true;
+	    counters.add(JSNSockCounters::sends);
+	    counters.add(JSNSockCounters::bytesSent, bytesSent);
+	    if (size_t(bytesSent) < remaining)
+		counters.add(JSNSockCounters::partialWrites);
+	    cursor	+= bytesSent;
+	    remaining	-= bytesSent;
 	}
-	setBlocking(true);
     }
-} /* JSNSockTCP::send(const void *buffer, uint32_t size) */
 
-auto JSNSockTCP::recv(
-	uint32_t	size
-	)		-> std::string
+    if (numbered)
+    {
+	if (!zeroCopyPending)
+	    zeroCopyPending.reset(new std::deque<std::pair<uint32_t, completion>>());
+	zeroCopyPending->push_back(std::make_pair(zeroCopyNext - 1, std::move(done)));
+    }
+    else if (done)
+	done();
+} /* JSNSockTCP::sendZeroCopy (const void *, size_t, completion) */
+
+auto JSNSockTCP::reapZeroCopy(
+	)		-> size_t
 {
-    std::unique_ptr<char>	buffer(new char[size]);
+    size_t	completed = 0;
 
-    if (timeout == 0.0)
+    while (zeroCopyWaiting())
     {
-	if ( ::recv(sockDesc, buffer.get(), size, 0) == -1)
+	char			control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+	struct msghdr		msg;
+	struct cmsghdr		*cmsg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_control		= control;
+	msg.msg_controllen	= sizeof(control);
+
+	if (::recvmsg(sockDesc, &msg, MSG_ERRQUEUE) == -1)
 	{
-	    throw JSNException("JSNSockTCP: recv (string) exception.");
+	    if (errno == EAGAIN || errno == EWOULDBLOCK)
+		break;
+	    else if (errno == EINTR)
+		continue;
+	    throw JSNException("JSNSockTCP: unable to read the zero-copy completion queue.");
 	}
-    }
-    else
-    {
-	setBlocking(false);
-	if ( ::recv(sockDesc, buffer.get(), size, 0) == -1)
+
+	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
 	{
-	    if (errno == EAGAIN)
-	    {
-		select();
-	    }
-	    else
+	    if (!( (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+		   (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR) ))
+		continue;
+
+	    struct sock_extended_err	*err = reinterpret_cast<struct sock_extended_err *>(CMSG_DATA(cmsg));
+	    if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+		continue;
+
+	    /* TCP completes in order: [ee_info, ee_data] are done, so	*/
+	    /* is every buffer whose last id is at or before ee_data.	*/
+	    while (zeroCopyWaiting() &&
+		    static_cast<int32_t>(zeroCopyPending->front().first - err->ee_data) <= 0)
 	    {
-		throw JSNException("JSNSockTCP: recv (string) exception.");
+		completion done = std::move(zeroCopyPending->front().second);
+		zeroCopyPending->pop_front();
+		completed++;
+		if (done)
+		    done();
 	    }
 	}
-	setBlocking(true);
     }
 
-    return (buffer.get()); /* may be empty */
+    return completed;
+} /* JSNSockTCP::reapZeroCopy () -> size_t */
+
+auto JSNSockTCP::awaitZeroCopy(
+	)		-> void
+{
+    clock::time_point	limit = deadline();
+
+    while (reapZeroCopy(), zeroCopyWaiting())
+	wait(0, limit);	/* POLLERR is always reported */
+}
+
+auto JSNSockTCP::setCork(
+	bool		on
+	)		-> void
+{
+    int		value = on ? 1 : 0;
+
+    setSockOption(IPPROTO_TCP, TCP_CORK, &value, sizeof(value));
+}
+
+auto JSNSockTCP::recvSome(
+	void			*buffer,
+	size_t			size,
+	clock::time_point	limit
+	)			-> size_t
+{
+    int		error;
+    size_t	bytesReceived = recvSome(buffer, size, limit, error);
+
+    if (error)
+    {
+	errno = error;
+	throw JSNException(error == ETIMEDOUT ? "JSNSockBase: operation timed-out."
+					      : "JSNSockTCP: recv exception.");
+    }
+
+    return bytesReceived;
+} /* JSNSockTCP::recvSome (void *, size_t, clock::time_point) -> size_t */
+
+auto JSNSockTCP::recvSome(
+	void			*buffer,
+	size_t			size,
+	clock::time_point	limit,
+	int			&error
+	)			-> size_t
+{
+    ssize_t	bytesReceived;
+
+    if (!sendBuffer.empty())	/* the peer may be waiting for it before it answers */
+    {
+	sendBuffered(limit, error);
+	if (error)
+	    return 0;
+    }
+
+    error = 0;
+    while ( (bytesReceived = ::recv(sockDesc, buffer, size, 0)) == -1 )
+    {
+	if (errno == EINTR)
+	    continue;
+
+	error = errno;
+	if (error == EAGAIN)
+	    counters.add(JSNSockCounters::wouldBlock);
+	if (error != EAGAIN || timeout == 0.0 ||
+		(error = waitFor(POLLIN, limit, JSNSockMetrics::recvWait)) != 0)
+	    return 0;
+    }
+
+    counters.add(JSNSockCounters::recvs);
+    counters.add(JSNSockCounters::bytesReceived, bytesReceived);
+
+    return bytesReceived;
+} /* JSNSockTCP::recvSome (void *, size_t, clock::time_point, int &) -> size_t */
+
+auto JSNSockTCP::refill(
+	clock::time_point	limit
+	)			-> size_t
+{
+    size_t	bytesReceived;
+    char	*space = recvBuffer.space();
+
+    if ( (bytesReceived = recvSome(space, recvBuffer.spaceSize(), limit)) )
+	recvBuffer.commit(bytesReceived);
+
+    return bytesReceived;
+} /* JSNSockTCP::refill (clock::time_point) -> size_t */
+
+auto JSNSockTCP::fill(
+	)		-> size_t
+{
+    return refill(deadline());
+}
+
+auto JSNSockTCP::setRecvBufferSize(
+	size_t		size
+	)		-> void
+{
+    recvBuffer.resize(size);
+}
+
+auto JSNSockTCP::peek(
+	)		-> JSNSockView
+{
+    if (recvBuffer.empty())
+	fill();
+
+    return recvBuffer.view();
+}
+
+auto JSNSockTCP::recv(
+	uint32_t	size
+	)		-> std::string
+{
+    JSNSockView		available = peek();
+    std::string		data(available.data, std::min<size_t>(size, available.size));
+
+    recvBuffer.consume(data.size());
+
+    return data; /* may be empty */
 } /* JSNSockTCP::recv (uint32_t size) -> std::string */
 
 auto JSNSockTCP::recv(
 	void		*buffer,
 	uint32_t	size
-	)		-> void
+	)		-> size_t
 {
-    int32_t bytesReceived;
+    if (recvBuffer.empty() && size >= recvBuffer.capacity())
+	return recvSome(buffer, size, deadline());	/* large reads bypass the buffer: one copy */
 
-    if (timeout == 0.0)
-    {
-	if ( (bytesReceived = ::recv(sockDesc, buffer, size, 0)) == -1)
-	{
-	    throw JSNException("JSNSockTCP: recv exception.");
-	}
-    }
-    else
+    JSNSockView		available = peek();
+    size_t		bytesReceived = std::min<size_t>(size, available.size);
+
+    memcpy(buffer, available.data, bytesReceived);
+    recvBuffer.consume(bytesReceived);
+
+    return bytesReceived;
+} /* JSNSockTCP::recv (void *buffer, uint32_t size) -> size_t */
+
+auto JSNSockTCP::recv(
+	void		*buffer,
+	size_t		size,
+	std::error_code	&error
+	)		-> size_t
+{
+    size_t	bytesReceived;
+    int		code = 0;
+    char	*space;
+
+    error.clear();
+    if (recvBuffer.empty())
     {
-	setBlocking(false);
-	if ( (bytesReceived = ::recv(sockDesc, buffer, size, 0)) == -1)
+	if (size >= recvBuffer.capacity())	/* large reads bypass the buffer: one copy */
+	    bytesReceived = recvSome(buffer, size, deadline(), code);
+	else
 	{
-	    if (errno == EAGAIN)
-	    {
-		select();
-	    }
-	    else
-	    {
-		throw JSNException("JSNSockTCP: recv exception.");
-	    }
+	    space = recvBuffer.space();	/* before 'spaceSize': it may compact */
+	    if ( (bytesReceived = recvSome(space, recvBuffer.spaceSize(), deadline(), code)) )
+		recvBuffer.commit(bytesReceived);
 	}
-	setBlocking(true);
+
+	if (code)
+	    error.assign(code, std::system_category());
+	if (recvBuffer.empty())	/* bypassed, failed or at end of stream */
+	    return bytesReceived;
     }
 
-    if (!bytesReceived)
-	buffer = nullptr;
-} /* JSNSockTCP::recv (void *buffer, uint32_t size) -> void */
+    JSNSockView		available = recvBuffer.view();
+
+    bytesReceived = std::min<size_t>(size, available.size);
+    memcpy(buffer, available.data, bytesReceived);
+    recvBuffer.consume(bytesReceived);
+
+    return bytesReceived;
+} /* JSNSockTCP::recv (void *, size_t, std::error_code &) -> size_t */
+
+auto JSNSockTCP::recv(
+	JSNSockLease	&buffer
+	)		-> size_t
+{
+    buffer.resize(recv(buffer.data(), buffer.capacity()));
+
+    return buffer.size();
+} /* JSNSockTCP::recv (JSNSockLease &buffer) -> size_t */
 
 auto JSNSockTCP::readline(
 	)		-> std::string
 {
-    bool caughtEOF	= false;
-    bool caughtEOL	= false;
-    std::string	line;
+    size_t		eol;
+    std::string		line;
+    clock::time_point	limit = deadline();	/* for the whole line, not each refill */
 
-    while (!caughtEOL && !caughtEOF)
+    while ( (eol = recvBuffer.find('\n')) == JSNSockBuffer::npos )
     {
-	char		buffer;
-	uint32_t	bytesReceived;
-
-	bytesReceived = ::recv(sockDesc, &buffer, 1, 0);
-	if (bytesReceived < 1)
-	    caughtEOF = true;
-	else if (buffer == '\n')
-	    caughtEOL = true;
-	else if (buffer != '\r')
-	    line += buffer;
+	if (recvBuffer.size() == recvBuffer.capacity())
+	    recvBuffer.reserve(recvBuffer.capacity());	/* line longer than the buffer: grow */
+
+	if (refill(limit) == 0)	/* EOF: hand back whatever is left */
+	{
+	    line.assign(recvBuffer.data(), recvBuffer.size());
+	    recvBuffer.clear();
+	    line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+	    return line;
+	}
     }
 
+    line.assign(recvBuffer.data(), eol);
+    recvBuffer.consume(eol + 1);
+    line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+
     if (line.empty())
-	(caughtEOF) ? line = "" : line = "\r";
+	line = "\r";	/* an empty line is distinguished from EOF */
 
     return line;
 } /* JSNSockTCP::readline() -> std::string */
 
-template<class T>
-auto JSNSockTCP::operator<< (
-	const T 	&buffer
+auto JSNSockTCP::append(
+	const char	*data,
+	size_t		size
 	)		-> void
 {
-    std::stringstream sstream(std::stringstream::in | std::stringstream::out);
-    sstream << buffer;
-    send (sstream.str());
-}
+    struct iovec	out[2];
 
-auto JSNSockTCP::operator<< (
-	const std::string	&buffer
+    if (sendBuffer.size() + size < sendThreshold)	/* the common case: a copy, no syscall */
+    {
+	memcpy(sendBuffer.space(), data, size);
+	sendBuffer.commit(size);
+	return;
+    }
+
+    /* what waits and the new bytes leave in one sendmsg(2), unjoined */
+    out[0].iov_base	= const_cast<char *>(sendBuffer.data());
+    out[0].iov_len	= sendBuffer.size();
+    out[1].iov_base	= const_cast<char *>(data);
+    out[1].iov_len	= size;
+
+    sendBuffer.clear();	/* the bytes stay put: nothing is appended until sendv returns */
+    sendv(out, 2);
+} /* JSNSockTCP::append */
+
+auto JSNSockTCP::sendBuffered(
+	clock::time_point	limit,
+	int			&error,
+	int			flags
 	)			-> void
 {
-    send (buffer);
+    struct iovec	rest;
+
+    rest.iov_base	= const_cast<char *>(sendBuffer.data());
+    rest.iov_len	= sendBuffer.size();
+    error		= 0;
+
+    sendBuffer.clear();
+    while (rest.iov_len > 0 && error == 0)
+    {
+	size_t	chunk = sendSome(&rest, 1, flags, limit, error);
+
+	rest.iov_base	= static_cast<char *>(rest.iov_base) + chunk;
+	rest.iov_len	-= chunk;
+    }
+} /* JSNSockTCP::sendBuffered */
+
+auto JSNSockTCP::flush(
+	)		-> void
+{
+    int		error;
+
+    if (sendBuffer.empty())
+	return;
+
+    sendBuffered(deadline(), error);
+    if (error)
+    {
+	errno = error;
+	throw JSNException(error == ETIMEDOUT ? "JSNSockBase: operation timed-out."
+					      : "JSNSockTCP: exception during attempt to send data.");
+    }
+} /* JSNSockTCP::flush */
+
+auto JSNSockTCP::setSendBufferSize(
+	size_t		size
+	)		-> void
+{
+    flush();
+    sendBuffer.resize(size ? size : 1);
+    setSendThreshold(sendThreshold);
+}
+
+auto JSNSockTCP::setSendThreshold(
+	size_t		size
+	)		-> void
+{
+    size_t	capacity = sendBuffer.capacity();
+
+    sendThreshold = (size == 0 || size > capacity) ? capacity : size;
 }
 
 auto JSNSockTCP::operator>> (
@@ -24,12 +24,57 @@
 #include "JSNSock.hpp"	/* brings <arpa/in.h> & <signal.h> */
 #include <thread>
 #include <unistd.h>	/* used for 'close(fd)' method */
-#include <iostream>
+#include <poll.h>	/* POLLIN, for a timed accept */
+#include <netinet/tcp.h>	/* TCP_DEFER_ACCEPT, TCP_FASTOPEN */
+#include <string.h>	/* strerror */
 
 /* Using */
 using namespace jsnSock;
 
 /* Implementation */
+auto JSNSockTCPServer::setReusePort(
+	bool			on
+	)			-> void
+{
+    int			value = on ? 1 : 0;
+
+    setSockOption(SOL_SOCKET, SO_REUSEPORT, &value, sizeof(value));
+}
+
+auto JSNSockTCPServer::setDeferAccept(
+	uint32_t		seconds
+	)			-> void
+{
+    int			value = seconds;
+
+    setSockOption(IPPROTO_TCP, TCP_DEFER_ACCEPT, &value, sizeof(value));
+}
+
+auto JSNSockTCPServer::setFastOpen(
+	uint32_t		queue
+	)			-> void
+{
+    int			value = queue;
+
+    setSockOption(IPPROTO_TCP, TCP_FASTOPEN, &value, sizeof(value));
+}
+
+auto JSNSockTCPServer::setBlocking(
+	bool			on
+	)			-> void
+{
+    JSNSockBase::setBlocking(on);
+    nonBlocking = !on;
+}
+
+auto JSNSockTCPServer::setTimeout(
+	double			timeout
+	)			-> void
+{
+    JSNSockBase::setTimeout(timeout);
+    nonBlocking = false;	/* may have switched: checked again when next needed */
+}
+
 auto JSNSockTCPServer::bind(
 	uint16_t		port,
 	const std::string	&address,
@@ -44,34 +89,100 @@ auto JSNSockTCPServer::bind(
     if ( (inet_aton(getHostByName(address).c_str(), &sockAddr.sin_addr) == 0) )
 	sockAddr.sin_addr.s_addr = any;
 
-    std::cerr << "Binding socket descriptor (" << sockDesc << ") to port (" << port << ")..." << std::endl;
+    JSN_LOG(info, "Binding socket descriptor (%d) to port (%u)...", sockDesc, unsigned(port));
     if ( ::bind(sockDesc, (struct sockaddr*) &sockAddr, sizeof(struct sockaddr)) == -1)
 	throw JSNException("JSNSockTCPServer: bind exception.");
 }
 
 auto JSNSockTCPServer::listen(
+	uint32_t		backlog
 	)			-> void
 {
-    std::cerr<< "Listening." << std::endl;
+    if (backlog != 0)
+	connection_max = backlog;
+
+    JSN_LOG(info, "Listening (backlog %u).", unsigned(connection_max));
     if ( ::listen(sockDesc, connection_max) == -1)
 	throw JSNException("JSNSockTCPServer: listen exception.");
 }
 
 auto JSNSockTCPServer::accept(
 	)			-> JSNSockTCP
+{
+    std::error_code	error;
+    JSNSockTCP		peer = accept(error);
+
+    if (error)
+    {
+	errno = error.value();
+	throw JSNException(errno == ETIMEDOUT ? "JSNSockBase: operation timed-out."
+					      : "JSNSockTCPServer: accept exception.");
+    }
+
+    return peer;
+}
+
+auto JSNSockTCPServer::accept(
+	std::error_code		&error
+	)			-> JSNSockTCP
 {
     int 		peerSockDesc;
-    struct sockaddr_in	sAddr;
-    socklen_t		size = sizeof(struct sockaddr);
+    int			code;
+    clock::time_point	limit = deadline();
 
-    do
+    while ( (peerSockDesc = ::accept4(sockDesc, nullptr, nullptr, SOCK_CLOEXEC)) == -1 )
     {
-	if ( (peerSockDesc = ::accept(sockDesc, (struct sockaddr *) &sAddr, &size)) == -1)
-	    throw JSNException("JSNSockTCPServer: accept exception.");
-    } while (peerSockDesc <= 0);
+	code = errno;
+	if (code == EINTR || code == ECONNABORTED)	/* nothing the caller could act on */
+	    continue;
 
+	/* a timed listener is non-blocking: wait for a connection until 'limit' */
+	if (code == EAGAIN)
+	{
+	    counters.add(JSNSockCounters::wouldBlock);
+	    if (timeout != 0.0 && (code = waitFor(POLLIN, limit)) == 0)
+		continue;
+	}
+	error.assign(code, std::system_category());
+	return JSNSockTCP(invalid);
+    }
+
+    counters.add(JSNSockCounters::accepts);
+    error.clear();
     return JSNSockTCP(peerSockDesc);
-}
+} /* JSNSockTCPServer::accept (std::error_code &) */
+
+auto JSNSockTCPServer::accept (
+	std::vector<JSNSockTCP>	&batch,
+	size_t			limit
+	)			-> size_t
+{
+    int			peerSockDesc;
+    size_t		accepted = 0;
+
+    if (!nonBlocking)
+	setBlocking(false);
+    while (limit == 0 || accepted < limit)
+    {
+	/* the flags replace an fcntl(2) pair per connection */
+	if ( (peerSockDesc = ::accept4(sockDesc, nullptr, nullptr,
+			SOCK_NONBLOCK | SOCK_CLOEXEC)) == -1)
+	{
+	    if (errno == EAGAIN || errno == EWOULDBLOCK)
+		break;
+	    else if (errno == EINTR || errno == ECONNABORTED)
+		continue;
+	    else
+		throw JSNException("JSNSockTCPServer: accept exception (batch).");
+	}
+
+	batch.emplace_back(peerSockDesc, 0.0);
+	counters.add(JSNSockCounters::accepts);
+	accepted++;
+    }
+
+    return accepted;
+} /* JSNSockTCPServer::accept */
 
 auto JSNSockTCPServer::accept (
 	void 			(*handler)(JSNSockTCP &socket)
@@ -88,7 +199,7 @@ auto JSNSockTCPServer::accept (
 	spawn_socket.close();
     }; /* lambda_accept */
 
-    std::cerr << "Accepting connections..." << std::endl;
+    JSN_LOG(debug, "Accepting connections on socket descriptor (%d)...", sockDesc);
     thread = std::thread(lambda_accept);
 
     if (thread.joinable())
@@ -101,3 +212,270 @@ auto JSNSockTCPServer::accept (
 
     return result;
 }
+
+auto JSNSockTCPServer::acceptPending (
+	JSNSockReactor		&reactor
+	)			-> void
+{
+    int			peerSockDesc;
+
+    while (1)	/* edge-triggered: drain the accept queue */
+    {
+	/* accepted non-blocking, whatever the timeout: no fcntl(2) pair later */
+	if ( (peerSockDesc = ::accept4(sockDesc, nullptr, nullptr,
+			SOCK_NONBLOCK | SOCK_CLOEXEC)) == -1)
+	{
+	    if (errno == EAGAIN || errno == EWOULDBLOCK)
+		break;
+	    else if (errno == EINTR || errno == ECONNABORTED)
+		continue;
+	    else if (errno == EBADF || errno == EINVAL || errno == ENOTSOCK)
+		throw JSNException("JSNSockTCPServer: accept exception (reactor).");
+
+	    /* out of descriptors or memory: the server, and every other	*/
+	    /* connection on this reactor, carries on; the connection stays	*/
+	    /* queued and is taken when the next one arrives.			*/
+	    counters.add(JSNSockCounters::acceptErrors);
+	    JSN_LOG(warning, "Accept on socket descriptor (%d) failed: %s.", sockDesc, strerror(errno));
+	    break;
+	}
+
+	counters.add(JSNSockCounters::accepts);
+
+	/* a connection closed outside its handler leaves a stale entry behind */
+	if (connections.count(peerSockDesc))
+	{
+	    reactor.remove(peerSockDesc);
+	    connections.erase(peerSockDesc);
+	}
+
+	JSNSockTCP	*connection = &connections.emplace(peerSockDesc,
+			JSNSockTCP(peerSockDesc, 0.0)).first->second;
+	connection->timeout = timeout;	/* the descriptor is non-blocking either way */
+	output.erase(peerSockDesc);	/* left behind by an earlier holder of the descriptor */
+
+	reactor.add(peerSockDesc,
+		JSNSockReactor::readable | JSNSockReactor::writable | JSNSockReactor::hangup,
+		[this, &reactor, connection, peerSockDesc](uint32_t events)
+		{
+		    handler(*connection, events);
+
+		    if (!connection->valid() ||
+			    (events & (JSNSockReactor::hangup | JSNSockReactor::error)))
+		    {
+			reactor.remove(peerSockDesc);
+			connections.erase(peerSockDesc);	/* closes the descriptor */
+		    }
+		});
+    }
+} /* JSNSockTCPServer::acceptPending */
+
+auto JSNSockTCPServer::attach (
+	JSNSockReactor		&reactor,
+	eventHandler		handler
+	)			-> void
+{
+    this->handler = std::move(handler);
+
+    if (!nonBlocking)
+	setBlocking(false);
+    reactor.add(sockDesc, JSNSockReactor::readable,
+	    [this, &reactor](uint32_t /* events */)
+	    {
+		acceptPending(reactor);
+	    });
+} /* JSNSockTCPServer::attach */
+
+auto JSNSockTCPServer::attach (
+	JSNSockReactor		&reactor,
+	streamHandler		handler
+	)			-> void
+{
+    stream	= std::move(handler);
+    ring	= nullptr;
+
+    attach(reactor, [this](JSNSockTCP &socket, uint32_t events)
+	    {
+		int		fd = socket.descriptor();
+		ssize_t		bytesReceived = 0;
+		JSNSockLease	buffer = JSNSockBufferPool::lease(JSN_RING_BUFFER_SIZE);
+
+		if (events & JSNSockReactor::writable)
+		    flush(socket);
+
+		/* edge-triggered: read until EAGAIN, end of stream or a close */
+		while (socket.valid())
+		{
+		    bytesReceived = ::recv(fd, buffer.data(), buffer.capacity(), 0);
+		    socket.counters.add(JSNSockCounters::recvs);
+
+		    if (bytesReceived > 0)
+		    {
+			socket.counters.add(JSNSockCounters::bytesReceived, bytesReceived);
+			stream(socket, JSNSockView { buffer.data(), size_t(bytesReceived) });
+		    }
+		    else if (bytesReceived == -1 && errno == EINTR)
+			continue;
+		    else if (bytesReceived == -1 && errno == EAGAIN)
+		    {
+			socket.counters.add(JSNSockCounters::wouldBlock);
+			break;
+		    }
+		    else
+		    {
+			stream(socket, JSNSockView { nullptr, 0 });
+			socket.close();
+		    }
+		}
+
+		if (!socket.valid())
+		    output.erase(fd);
+	    });
+} /* JSNSockTCPServer::attach (JSNSockReactor &, streamHandler) */
+
+auto JSNSockTCPServer::attach (
+	JSNSockRing		&ring,
+	streamHandler		handler
+	)			-> void
+{
+    stream	= std::move(handler);
+    this->ring	= &ring;
+
+    ring.accept(sockDesc, [this, &ring](int peerSockDesc)
+	    {
+		if (peerSockDesc < 0)	/* e.g. EMFILE; the ring re-arms the accept after a pause */
+		{
+		    counters.add(JSNSockCounters::acceptErrors);
+		    JSN_LOG(warning, "Accept on socket descriptor (%d) failed: %s.", sockDesc, strerror(-peerSockDesc));
+		    return;
+		}
+
+		counters.add(JSNSockCounters::accepts);
+
+		if (connections.count(peerSockDesc))
+		    drop(peerSockDesc);
+
+		JSNSockTCP	*connection = &connections.emplace(peerSockDesc,
+				JSNSockTCP(peerSockDesc, timeout)).first->second;
+
+		ring.recv(peerSockDesc, [this, connection, peerSockDesc](JSNSockView data, int /* error */)
+			{
+			    connection->counters.add(JSNSockCounters::recvs);
+			    connection->counters.add(JSNSockCounters::bytesReceived, data.size);
+			    stream(*connection, data);
+
+			    if (data.empty() || !connection->valid())
+				drop(peerSockDesc);
+			});
+	    });
+} /* JSNSockTCPServer::attach (JSNSockRing &, streamHandler) */
+
+auto JSNSockTCPServer::drop (
+	int			fd
+	)			-> void
+{
+    if (ring)
+	ring->cancel(fd);	/* before the close, so no completion outlives the connection */
+    output.erase(fd);
+    connections.erase(fd);	/* closes the descriptor */
+}
+
+auto JSNSockTCPServer::flush (
+	JSNSockTCP		&socket
+	)			-> void
+{
+    auto found = output.find(socket.descriptor());
+    if (found == output.end())
+	return;
+
+    std::string	&queued = found->second.queued;
+    size_t	sent = 0;
+    ssize_t	result;
+
+    while (sent < queued.size())
+    {
+	result = ::send(socket.descriptor(), queued.data() + sent, queued.size() - sent,
+		MSG_NOSIGNAL | MSG_DONTWAIT);
+
+	socket.counters.add(JSNSockCounters::sends);
+	if (result >= 0)
+	{
+	    socket.counters.add(JSNSockCounters::bytesSent, result);
+	    if (sent + result < queued.size())
+		socket.counters.add(JSNSockCounters::partialWrites);
+	    sent += result;
+	}
+	else if (errno == EINTR)
+	    continue;
+	else if (errno == EAGAIN)
+	{
+	    socket.counters.add(JSNSockCounters::wouldBlock);
+	    break;
+	}
+	else
+	{
+	    socket.close();	/* the peer is gone; the reactor drops the connection */
+	    return;
+	}
+    }
+
+    queued.erase(0, sent);
+} /* JSNSockTCPServer::flush */
+
+auto JSNSockTCPServer::transmit (
+	int			fd,
+	std::string		data
+	)			-> void
+{
+    output[fd].inFlight = true;
+
+    ring->send(fd, std::move(data), [this, fd](int result)
+	    {
+		auto found = output.find(fd);
+		if (found == output.end())
+		    return;
+
+		if (result < 0)
+		{
+		    drop(fd);
+		    return;
+		}
+
+		auto connection = connections.find(fd);
+		if (connection != connections.end())
+		{
+		    connection->second.counters.add(JSNSockCounters::sends);
+		    connection->second.counters.add(JSNSockCounters::bytesSent, result);
+		}
+
+		/* everything replied meanwhile goes out as one submission */
+		std::string	next;
+		next.swap(found->second.queued);
+		found->second.inFlight = false;
+
+		if (!next.empty())
+		    transmit(fd, std::move(next));
+	    });
+} /* JSNSockTCPServer::transmit */
+
+auto JSNSockTCPServer::reply (
+	JSNSockTCP		&socket,
+	std::string		data
+	)			-> void
+{
+    if (!socket.valid() || data.empty())
+	return;
+
+    int			fd = socket.descriptor();
+    pendingOutput	&pending = output[fd];
+
+    if (ring == nullptr)	/* reactor: send now, keep the rest for 'writable' */
+    {
+	pending.queued += data;
+	flush(socket);
+    }
+    else if (pending.inFlight)
+	pending.queued += data;
+    else
+	transmit(fd, std::move(data));
+} /* JSNSockTCPServer::reply */
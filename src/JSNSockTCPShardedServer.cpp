@@ -0,0 +1,170 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+
+/* Include */
+#include "JSNSock.hpp"
+#include <pthread.h>	/* used for 'pthread_setaffinity_np' */
+#include <sched.h>	/* used for the 'cpu_set_t' macros */
+#include <exception>
+#include <mutex>
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+JSNSockTCPShardedServer::JSNSockTCPShardedServer(
+	uint32_t			shards,
+	JSNSockTCPServer::engine	preferred
+	)
+{
+    bool	ringed = (preferred == JSNSockTCPServer::uring) && JSNSockRing::available();
+
+    if (shards == 0)
+	shards = std::thread::hardware_concurrency();
+    if (shards == 0)	/* hardware_concurrency may not be computable */
+	shards = 1;
+
+    for (uint32_t i = 0; i < shards; i++)
+    {
+	servers.emplace_back(new JSNSockTCPServer());
+	servers.back()->setReusePort();
+	reactors.emplace_back(new JSNSockReactor());
+	if (ringed)
+	    rings.emplace_back(new JSNSockRing());
+    }
+}
+
+JSNSockTCPShardedServer::~JSNSockTCPShardedServer()
+{
+    stop();
+    for (std::thread &worker : workers)
+	if (worker.joinable())
+	    worker.join();
+}
+
+auto JSNSockTCPShardedServer::setDeferAccept(
+	uint32_t		seconds
+	)			-> void
+{
+    for (auto &server : servers)
+	server->setDeferAccept(seconds);
+}
+
+auto JSNSockTCPShardedServer::setFastOpen(
+	uint32_t		queue
+	)			-> void
+{
+    for (auto &server : servers)
+	server->setFastOpen(queue);
+}
+
+auto JSNSockTCPShardedServer::bind(
+	uint16_t		port,
+	const std::string	&address,
+	uint32_t		capacity
+	)			-> void
+{
+    for (auto &server : servers)
+	server->bind(port, address, capacity);
+}
+
+auto JSNSockTCPShardedServer::listen(
+	uint32_t		backlog
+	)			-> void
+{
+    for (auto &server : servers)
+	server->listen(backlog);
+}
+
+template <typename Loop, typename Handler>
+auto JSNSockTCPShardedServer::run(
+	std::vector<std::unique_ptr<Loop>>	&loops,
+	const Handler				&handler
+	)					-> void
+{
+    std::exception_ptr	failure;
+    std::mutex		failureLock;
+    uint32_t		cores = std::thread::hardware_concurrency();
+
+    for (uint32_t i = 0; i < servers.size(); i++)
+    {
+	workers.emplace_back([this, i, cores, &loops, &handler, &failure, &failureLock](
+		)
+	{
+	    try
+	    {
+		if (cores)
+		{
+		    cpu_set_t	set;
+		    CPU_ZERO(&set);
+		    CPU_SET(i % cores, &set);
+		    /* pinning is an optimisation; an unpinned shard still serves */
+		    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		}
+
+		servers[i]->attach(*loops[i], handler);
+		loops[i]->run();
+	    }
+	    catch (...)
+	    {
+		std::lock_guard<std::mutex>	guard(failureLock);
+		if (!failure)
+		    failure = std::current_exception();
+		stop();	/* bring the other shards down with this one */
+	    }
+	}); /* worker */
+    }
+
+    for (std::thread &worker : workers)
+	worker.join();
+    workers.clear();
+
+    if (failure)
+	std::rethrow_exception(failure);
+} /* JSNSockTCPShardedServer::run */
+
+auto JSNSockTCPShardedServer::serve(
+	JSNSockTCPServer::eventHandler	handler
+	)				-> void
+{
+    run(reactors, handler);
+}
+
+auto JSNSockTCPShardedServer::serve(
+	JSNSockTCPServer::streamHandler	handler
+	)				-> void
+{
+    if (rings.empty())
+	run(reactors, handler);
+    else
+	run(rings, handler);
+}
+
+auto JSNSockTCPShardedServer::stop(
+	)			-> void
+{
+    for (auto &reactor : reactors)
+	reactor->stop();
+    for (auto &ring : rings)
+	ring->stop();
+}
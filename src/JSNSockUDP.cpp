@@ -0,0 +1,411 @@
+ /** jsnSock - A High-Level Network (TCP) Sockets Library
+ *
+ * The files in this directory and elsewhere which refer to this LICENCE
+ * file are part of jsnSock -- a network sockets library in c++11 syntax
+ *
+ * Copyright (C) 2012 Jason Browning, <z.jason.browning@gmail.com>
+ *
+ * jsnSock is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation; either version 3 or (at your option) any later
+ * version.
+ *
+ * jsnSock is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with jsnSock; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02111-1301 USA.
+ */
+
+/* Includes */
+#include "JSNSock.hpp"
+#include <algorithm>
+#include <netinet/udp.h>	/* UDP_SEGMENT, UDP_GRO */
+#include <poll.h>
+#include <string.h>
+
+/* Using */
+using namespace jsnSock;
+
+/* Implementation */
+
+/* JSNSockDatagramBatch */
+JSNSockDatagramBatch::JSNSockDatagramBatch(
+	uint32_t	capacity,
+	size_t		datagramSize
+	)
+: storage(size_t(capacity ? capacity : 1) * datagramSize),
+  headers(capacity ? capacity : 1), iov(capacity ? capacity : 1), peers(capacity ? capacity : 1),
+  slotSize(datagramSize), count(0)
+{
+    memset(headers.data(), 0, headers.size() * sizeof(struct mmsghdr));
+    memset(peers.data(), 0, peers.size() * sizeof(JSNSockAddress));
+
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+	headers[i].msg_hdr.msg_iov	= &iov[i];
+	headers[i].msg_hdr.msg_iovlen	= 1;
+    }
+}
+
+auto JSNSockDatagramBatch::prepareReceive(
+	)		-> void
+{
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+	iov[i].iov_base			= storage.data() + i * slotSize;
+	iov[i].iov_len			= slotSize;
+	headers[i].msg_len		= 0;
+	headers[i].msg_hdr.msg_name	= &peers[i].storage;
+	headers[i].msg_hdr.msg_namelen	= sizeof(peers[i].storage);
+	headers[i].msg_hdr.msg_flags	= 0;
+    }
+    count = 0;
+}
+
+auto JSNSockDatagramBatch::add(
+	const void		*data,
+	size_t			size,
+	const JSNSockAddress	*to
+	)			-> bool
+{
+    if (count == headers.size())
+	return false;
+
+    iov[count].iov_base	= const_cast<void *>(data);
+    iov[count].iov_len	= size;
+    headers[count].msg_len = size;
+    headers[count].msg_hdr.msg_flags = 0;
+
+    if (to)
+    {
+	peers[count] = *to;
+	headers[count].msg_hdr.msg_name		= &peers[count].storage;
+	headers[count].msg_hdr.msg_namelen	= peers[count].length;
+    }
+    else
+    {
+	headers[count].msg_hdr.msg_name		= nullptr;
+	headers[count].msg_hdr.msg_namelen	= 0;
+    }
+
+    count++;
+    return true;
+}
+
+
+/* JSNSockUDP */
+JSNSockUDP::JSNSockUDP(
+	uint32_t	domain,
+	double		timeout
+	)
+: JSNSockBase(domain, type::datagram, protocol::udp, timeout)
+{
+}
+
+auto JSNSockUDP::address(
+	const std::string	&host,
+	uint16_t		port
+	)			-> JSNSockAddress
+{
+    JSNSockAddress	address = JSNSockResolver::shared().resolve(host, domain, timeout).front();
+
+    address.setPort(port);
+    return address;
+}
+
+auto JSNSockUDP::bind(
+	uint16_t		port,
+	const std::string	&address
+	)			-> void
+{
+    JSNSockAddress	local;
+
+    if (address.empty())
+    {
+	memset(&local, 0, sizeof(local));
+	local.storage.ss_family	= domain;	/* zeroed: INADDR_ANY / in6addr_any */
+	local.length		= (domain == domain::inet6) ?
+	    sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+	local.setPort(port);
+    }
+    else
+	local = this->address(address, port);
+
+    if ( ::bind(sockDesc, local.sockaddr(), local.length) == -1 )
+	throw JSNException("JSNSockUDP: bind exception.");
+}
+
+auto JSNSockUDP::connect(
+	const std::string	&host,
+	uint16_t		port
+	)			-> void
+{
+    JSNSockAddress	remote = address(host, port);
+
+    if ( ::connect(sockDesc, remote.sockaddr(), remote.length) == -1 )
+	throw JSNException("JSNSockUDP: connect exception.");
+}
+
+auto JSNSockUDP::sendTo(
+	const void		*buffer,
+	size_t			size,
+	const JSNSockAddress	*to
+	)			-> void
+{
+    clock::time_point	limit = deadline();
+
+    while ( ::sendto(sockDesc, buffer, size, MSG_NOSIGNAL,
+		to ? to->sockaddr() : nullptr, to ? to->length : 0) == -1 )
+    {
+	if (errno == EINTR)
+	    continue;
+	else if (errno == EAGAIN && timeout != 0.0)
+	    wait(POLLOUT, limit);
+	else
+	    throw JSNException("JSNSockUDP: exception during attempt to send a datagram.");
+    }
+}
+
+auto JSNSockUDP::recvFrom(
+	void			*buffer,
+	size_t			size,
+	JSNSockAddress		*from
+	)			-> size_t
+{
+    clock::time_point	limit = deadline();
+    ssize_t		bytesReceived;
+    socklen_t		length = from ? sizeof(from->storage) : 0;
+
+    while ( (bytesReceived = ::recvfrom(sockDesc, buffer, size, 0,
+		    from ? reinterpret_cast<struct sockaddr *>(&from->storage) : nullptr,
+		    from ? &length : nullptr)) == -1 )
+    {
+	if (errno == EINTR)
+	    continue;
+	else if (errno == EAGAIN && timeout != 0.0)
+	    wait(POLLIN, limit);
+	else
+	    throw JSNException("JSNSockUDP: recvFrom exception.");
+    }
+
+    if (from)
+	from->length = length;
+
+    return bytesReceived;
+}
+
+auto JSNSockUDP::send(
+	JSNSockDatagramBatch	&batch
+	)			-> uint32_t
+{
+    clock::time_point	limit = deadline();
+    uint32_t		sent = 0;
+    int			result;
+
+    while (sent < batch.count)
+    {
+	if ( (result = ::sendmmsg(sockDesc, batch.headers.data() + sent, batch.count - sent, MSG_NOSIGNAL)) == -1 )
+	{
+	    if (errno == EINTR)
+		continue;
+	    else if (errno == EAGAIN && timeout != 0.0)
+		wait(POLLOUT, limit);
+	    else
+		throw JSNException("JSNSockUDP: exception during attempt to send a batch.");
+	}
+	else
+	    sent += result;
+    }
+
+    batch.count = 0;
+    return sent;
+} /* JSNSockUDP::send (JSNSockDatagramBatch &) -> uint32_t */
+
+auto JSNSockUDP::recv(
+	JSNSockDatagramBatch	&batch
+	)			-> uint32_t
+{
+    clock::time_point	limit = deadline();
+    int			result;
+
+    batch.prepareReceive();
+
+    while ( (result = ::recvmmsg(sockDesc, batch.headers.data(), batch.headers.size(),
+		    MSG_WAITFORONE, nullptr)) == -1 )
+    {
+	if (errno == EINTR)
+	    continue;
+	else if (errno == EAGAIN && timeout != 0.0)
+	    wait(POLLIN, limit);
+	else
+	    throw JSNException("JSNSockUDP: exception during attempt to receive a batch.");
+    }
+
+    for (int i = 0; i < result; i++)
+	batch.peers[i].length = batch.headers[i].msg_hdr.msg_namelen;
+
+    batch.count = result;
+    return batch.count;
+} /* JSNSockUDP::recv (JSNSockDatagramBatch &) -> uint32_t */
+
+auto JSNSockUDP::sendSegmented(
+	const void		*buffer,
+	size_t			size,
+	uint16_t		segment,
+	const JSNSockAddress	*to
+	)			-> uint32_t
+{
+    clock::time_point	limit = deadline();
+    const char		*cursor = static_cast<const char *>(buffer);
+    uint32_t		datagrams = 0;
+    size_t		unit;
+    ssize_t		result;
+
+    if (segment == 0)
+    {
+	errno = EINVAL;
+	throw JSNException("JSNSockUDP: segment size must be non-zero.");
+    }
+
+    /* Largest whole number of segments the kernel accepts in one send */
+    unit = std::min<size_t>(JSN_UDP_GSO_SEGMENTS, JSN_UDP_GSO_BYTES / segment) * segment;
+    if (unit == 0)
+    {
+	errno = EMSGSIZE;
+	throw JSNException("JSNSockUDP: segment size exceeds one datagram.");
+    }
+
+    union
+    {
+	char		buf[CMSG_SPACE(sizeof(uint16_t))];
+	struct cmsghdr	align;
+    } control;
+
+    while (size > 0)
+    {
+	size_t		chunk = std::min(size, unit);
+	struct iovec	iov = { const_cast<char *>(cursor), chunk };
+	struct msghdr	msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name	= to ? const_cast<struct sockaddr *>(to->sockaddr()) : nullptr;
+	msg.msg_namelen	= to ? to->length : 0;
+	msg.msg_iov	= &iov;
+	msg.msg_iovlen	= 1;
+
+	/* A single-segment chunk goes out as an ordinary datagram */
+	if (chunk > segment)
+	{
+	    memset(&control, 0, sizeof(control));
+	    msg.msg_control	= control.buf;
+	    msg.msg_controllen	= sizeof(control.buf);
+
+	    struct cmsghdr *cm	= CMSG_FIRSTHDR(&msg);
+	    cm->cmsg_level	= IPPROTO_UDP;
+	    cm->cmsg_type	= UDP_SEGMENT;
+	    cm->cmsg_len	= CMSG_LEN(sizeof(uint16_t));
+	    memcpy(CMSG_DATA(cm), &segment, sizeof(segment));
+	}
+
+	if ( (result = ::sendmsg(sockDesc, &msg, MSG_NOSIGNAL)) == -1 )
+	{
+	    if (errno == EINTR)
+		continue;
+	    else if (errno == EAGAIN && timeout != 0.0)
+		wait(POLLOUT, limit);
+	    else
+		throw JSNException("JSNSockUDP: exception during attempt to send segmented datagrams.");
+	    continue;
+	}
+
+	datagrams	+= (chunk + segment - 1) / segment;
+	cursor		+= chunk;
+	size		-= chunk;
+    }
+
+    return datagrams;
+} /* JSNSockUDP::sendSegmented */
+
+auto JSNSockUDP::setGRO(
+	bool		enable
+	)		-> void
+{
+    int		value = enable ? 1 : 0;
+
+    if ( setsockopt(sockDesc, IPPROTO_UDP, UDP_GRO, &value, sizeof(value)) == -1 )
+	throw JSNException("JSNSockUDP: unable to set UDP_GRO.");
+}
+
+auto JSNSockUDP::recvSegmented(
+	void				*buffer,
+	size_t				size,
+	std::vector<JSNSockView>	&segments,
+	JSNSockAddress			*from
+	)				-> size_t
+{
+    clock::time_point	limit = deadline();
+    struct iovec	iov = { buffer, size };
+    struct msghdr	msg;
+    ssize_t		bytesReceived;
+    size_t		segment = 0;
+
+    union
+    {
+	char		buf[CMSG_SPACE(sizeof(int))];
+	struct cmsghdr	align;
+    } control;
+
+    for (;;)
+    {
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name		= from ? &from->storage : nullptr;
+	msg.msg_namelen		= from ? sizeof(from->storage) : 0;
+	msg.msg_iov		= &iov;
+	msg.msg_iovlen		= 1;
+	msg.msg_control		= control.buf;
+	msg.msg_controllen	= sizeof(control.buf);
+
+	if ( (bytesReceived = ::recvmsg(sockDesc, &msg, 0)) != -1 )
+	    break;
+
+	if (errno == EINTR)
+	    continue;
+	else if (errno == EAGAIN && timeout != 0.0)
+	    wait(POLLIN, limit);
+	else
+	    throw JSNException("JSNSockUDP: exception during attempt to receive segmented datagrams.");
+    }
+
+    if (from)
+	from->length = msg.msg_namelen;
+
+    /* The kernel reports the original datagram size only when it merged */
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+	if (cm->cmsg_level == IPPROTO_UDP && cm->cmsg_type == UDP_GRO)
+	{
+	    int		value;
+	    memcpy(&value, CMSG_DATA(cm), sizeof(value));
+	    segment = value;
+	}
+
+    if (segment == 0)
+	segment = bytesReceived ? bytesReceived : 1;
+
+    const char	*cursor = static_cast<const char *>(buffer);
+    size_t	left = bytesReceived;
+
+    segments.clear();
+    do
+    {
+	size_t	length = std::min(left, segment);
+	segments.push_back(JSNSockView { cursor, length });
+	cursor	+= length;
+	left	-= length;
+    } while (left > 0);
+
+    return bytesReceived;
+} /* JSNSockUDP::recvSegmented */
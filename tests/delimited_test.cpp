@@ -0,0 +1,285 @@
+/**
+ * jsnSock loopback tests: JSNSockDelimiter and JSNSockDelimitedChannel
+ *
+ * Every scanning kernel this build and CPU offer (scalar, SSE2, AVX2)
+ * must find exactly the matches a byte-by-byte reference finds: at every
+ * offset across the 16- and 32-byte blocks the SIMD kernels load, for
+ * delimiters that overlap themselves ("aa" in "aaa"), and for more
+ * matches than one kernel pass collects.  The channel is then run over
+ * a socket with each kernel, end-of-stream and length limits included.
+ *
+ * (C) 2012 Jason Browning
+ */
+
+#include <string.h>
+#include <sys/socket.h>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <JSNSockDelimited.hpp>
+#include "jsnsock_test.hpp"
+
+using namespace std;
+using namespace jsnSock;
+using namespace jsnSockTest;
+
+static const uint16_t	basePort = 47400;
+
+typedef vector<pair<size_t, size_t>>	tokens;	/* offset and size of each */
+
+/* Byte-by-byte: non-overlapping matches, leftmost first */
+static auto reference (const string &data, const string &delimiter,
+			size_t from, tokens &found)			-> size_t
+{
+    size_t	start = 0;
+    size_t	at = from;
+
+    while (at + delimiter.size() <= data.size())
+    {
+	if (memcmp(data.data() + at, delimiter.data(), delimiter.size()) == 0)
+	{
+	    found.push_back(make_pair(start, at - start));
+	    start = at = at + delimiter.size();
+	}
+	else
+	    at++;
+    }
+    return start;
+}
+
+/* 'split' and 'find' against the reference, on one buffer */
+static auto agrees (const JSNSockDelimiter &delimiter, const string &data,
+			size_t from = 0)				-> bool
+{
+    vector<JSNSockView>	views;
+    tokens		expected;
+    tokens		got;
+    size_t		used = delimiter.split(data.data(), data.size(), views, from);
+    size_t		first;
+
+    for (const JSNSockView &view : views)
+	got.push_back(make_pair(size_t(view.data - data.data()), view.size));
+    if (used != reference(data, delimiter.str(), from, expected) || got != expected)
+	return false;
+
+    first = expected.empty() ? JSNSockDelimiter::npos : expected[0].first + expected[0].second;
+    return delimiter.find(data.data(), data.size(), from) == first;
+}
+
+static auto kernels ()							-> vector<string>
+{
+    vector<string>	available;
+
+    for (const char *name : { "scalar", "sse2", "avx2" })
+    {
+	try
+	{
+	    JSNSockDelimiter::setEngine(name);
+	    available.push_back(name);
+	}
+	catch (const JSNException &e)
+	{
+	    CHECK(e.code() == EINVAL);	/* not in this build, or not on this CPU */
+	}
+    }
+    JSNSockDelimiter::setEngine("");
+    return available;
+}
+
+static const vector<string>	delimiters = {
+    "\n", "\r\n", string("\0", 1), "\r\n\r\n", "aa", "aba", "--boundary--",
+    string(40, '=')	/* longer than any block */
+};
+
+/* One delimiter at every offset of buffers up to three blocks long */
+static auto boundaries ()						-> void
+{
+    for (const string &sequence : delimiters)
+    {
+	JSNSockDelimiter	delimiter(sequence);
+	bool			ok = true;
+
+	for (size_t size = sequence.size(); size <= 100; size++)
+	    for (size_t at = 0; at + sequence.size() <= size; at++)
+	    {
+		string	data(size, 'x');
+
+		data.replace(at, sequence.size(), sequence);
+		ok = ok && agrees(delimiter, data);
+		ok = ok && agrees(delimiter, data, at / 2);
+		if (at >= 16)	/* a first and last byte either side of a block edge */
+		    ok = ok && agrees(delimiter, data.substr(at - 16));
+	    }
+	CHECK(ok);
+    }
+}
+
+static auto overlapping ()						-> void
+{
+    JSNSockDelimiter	pair("aa");
+    JSNSockDelimiter	triple("aba");
+    vector<JSNSockView>	views;
+
+    /* "aaa": one match at zero, and the 'a' left over starts none */
+    CHECK(pair.split("aaa", 3, views) == 2 && views.size() == 1 && views[0].size == 0);
+    CHECK(pair.find("aaa", 3) == 0);
+    CHECK(pair.find("aaa", 3, 1) == 1);	/* from one, the second 'a' starts a match */
+
+    views.clear();
+    CHECK(pair.split("aaaa", 4, views) == 4 && views.size() == 2);
+
+    views.clear();
+    CHECK(triple.split("ababa", 5, views) == 3 && views.size() == 1);
+
+    /* runs of the delimiter's own byte across every block edge */
+    bool	ok = true;
+    for (size_t size = 1; size <= 100; size++)
+    {
+	ok = ok && agrees(pair, string(size, 'a'));
+	ok = ok && agrees(triple, string(size, 'a') + "ba" + string(size, 'b'));
+    }
+    CHECK(ok);
+}
+
+/* More matches than one pass of a kernel collects, and random input */
+static auto dense ()							-> void
+{
+    mt19937		random(2012);
+    bool		ok = true;
+
+    for (const string &sequence : delimiters)
+    {
+	JSNSockDelimiter	delimiter(sequence);
+	string			run;
+
+	for (size_t i = 0; i < 3 * JSN_SCAN_BATCH + 1; i++)
+	    run += sequence + (i % 3 ? "" : "x");
+	ok = ok && agrees(delimiter, run);
+
+	/* an alphabet small enough that candidates are everywhere */
+	string	alphabet = sequence + "xa";
+	for (int trial = 0; trial < 300; trial++)
+	{
+	    string	data(random() % 300, ' ');
+
+	    for (char &c : data)
+		c = alphabet[random() % alphabet.size()];
+	    ok = ok && agrees(delimiter, data, data.empty() ? 0 : random() % data.size());
+	}
+    }
+    CHECK(ok);
+}
+
+/* 'text' written as it is, then end-of-stream */
+static auto inject (loopback &link, const string &text)			-> void
+{
+    ::send(link.client.descriptor(), text.data(), text.size(), MSG_NOSIGNAL);
+    link.client.close();
+}
+
+static auto channel (uint16_t port)					-> void
+{
+    string		text;
+    vector<string>	lines;
+
+    for (size_t i = 0; i < 2000; i++)
+    {
+	lines.push_back(string(i % 97, char('a' + i % 26)));
+	text += lines.back() + "\r\n";
+    }
+    lines.push_back("unterminated");
+    text += lines.back();
+
+    /* one record at a time */
+    {
+	loopback		link(port++);
+	JSNSockDelimitedChannel	records(link.peer, "\r\n");
+	JSNSockView		record;
+	size_t			count = 0;
+	bool			ok = true;
+
+	inject(link, text);
+	while (records.next(record))
+	    ok = ok && count < lines.size() && string(record.data, record.size) == lines[count++];
+	CHECK(ok && count == lines.size());
+    }
+
+    /* in batches */
+    {
+	loopback		link(port++);
+	JSNSockDelimitedChannel	records(link.peer, "\r\n");
+	vector<JSNSockView>	batch;
+	size_t			count = 0;
+	bool			ok = true;
+
+	inject(link, text);
+	while (records.receive(batch))
+	    for (const JSNSockView &record : batch)
+		ok = ok && count < lines.size() && string(record.data, record.size) == lines[count++];
+	CHECK(ok && count == lines.size());
+    }
+}
+
+static auto limits (uint16_t port)					-> void
+{
+    JSNSockView		record;
+    vector<JSNSockView>	batch;
+
+    /* a delimited record one byte over the limit */
+    {
+	loopback		link(port++);
+	JSNSockDelimitedChannel	records(link.peer, "\r\n", 10);
+
+	inject(link, "0123456789\r\n0123456789A\r\n");
+	CHECK(records.next(record) && record.size == 10);
+	CHECK_THROWS(records.next(record), EMSGSIZE);
+    }
+
+    /* an unterminated last record is held to the same limit */
+    for (int batched = 0; batched < 2; batched++)
+    {
+	loopback		link(port++);
+	JSNSockDelimitedChannel	records(link.peer, "\r\n", 10);
+
+	inject(link, "0123456789A");
+	if (batched)
+	    CHECK_THROWS(records.receive(batch), EMSGSIZE);
+	else
+	    CHECK_THROWS(records.next(record), EMSGSIZE);
+    }
+
+    /* and one at the limit is handed back */
+    {
+	loopback		link(port++);
+	JSNSockDelimitedChannel	records(link.peer, "\r\n", 10);
+
+	inject(link, "0123456789");
+	CHECK(records.next(record) && record.size == 10);
+	CHECK(!records.next(record));
+    }
+
+    CHECK_THROWS(JSNSockDelimiter(""), EINVAL);
+    CHECK_THROWS(JSNSockDelimiter::setEngine("neon"), EINVAL);
+}
+
+int main ()
+{
+    uint16_t	port = basePort;
+
+    for (const string &name : kernels())
+    {
+	JSNSockDelimiter::setEngine(name);
+	CHECK(JSNSockDelimiter::engine() == name);
+	cout << "delimited: kernel " << name << endl;
+
+	boundaries();
+	overlapping();
+	dense();
+	channel(port);
+	limits(port + 2);
+	port += 10;
+    }
+
+    return summary("delimited");
+}
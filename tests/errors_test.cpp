@@ -0,0 +1,219 @@
+/**
+ * jsnSock loopback tests: error-code forms and JSNException
+ *
+ * connect, send, recv and accept with a std::error_code report failures
+ * (EAGAIN, ETIMEDOUT, ECONNREFUSED, ECONNRESET/EPIPE) without throwing;
+ * on the paths the header promises allocate nothing -- a would-block
+ * accept, an accept, moving a socket, steady-state send and recv -- a
+ * counting operator new must see no call.  A timed server's accept
+ * waits for a late connection and times out when none comes, and a
+ * socket assigned over sends its buffered output first.
+ *
+ * (C) 2012 Jason Browning
+ */
+
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <chrono>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include "jsnsock_test.hpp"
+
+using namespace std;
+using namespace jsnSock;
+using namespace jsnSockTest;
+
+static const uint16_t	basePort = 47500;
+static size_t		allocations = 0;
+
+void *operator new (size_t size)
+{
+    void	*block = malloc(size ? size : 1);
+
+    if (block == nullptr)
+	throw bad_alloc();
+    allocations++;
+    return block;
+}
+
+void operator delete (void *block) noexcept
+{
+    free(block);
+}
+
+void operator delete (void *block, size_t) noexcept
+{
+    free(block);
+}
+
+static auto accepts (uint16_t port)					-> void
+{
+    JSNSockTCPServer	server;
+    error_code		error;
+    int			on = 1;
+    size_t		before;
+
+    server.setSockOption(SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    server.bind(port, "127.0.0.1");
+    server.listen();
+    server.setBlocking(false);
+
+    /* nothing pending: an invalid socket, EAGAIN, and no allocation */
+    before = allocations;
+    JSNSockTCP	none = server.accept(error);
+    CHECK(allocations == before);
+    CHECK(!none.valid() && error.value() == EAGAIN);
+
+    JSNSockTCP	client("127.0.0.1", port);
+
+    before = allocations;
+    JSNSockTCP	peer = server.accept(error);
+    CHECK(allocations == before);
+    CHECK(peer.valid() && !error);
+
+    /* moving a socket copies handles, never buffers */
+    before = allocations;
+    JSNSockTCP	moved(std::move(peer));
+    peer = std::move(moved);
+    CHECK(allocations == before);
+    CHECK(peer.valid() && !moved.valid());
+}
+
+static auto timedAccepts (uint16_t port)				-> void
+{
+    typedef chrono::steady_clock	testClock;
+    JSNSockTCPServer			server;
+    error_code				error;
+    int					on = 1;
+
+    server.setSockOption(SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    server.bind(port, "127.0.0.1");
+    server.listen();
+    server.setTimeout(2.0);
+
+    /* a client that connects well after 'accept' starts waiting */
+    thread	late([port]()
+		{
+		    this_thread::sleep_for(chrono::milliseconds(300));
+		    JSNSockTCP	client("127.0.0.1", port);
+		    this_thread::sleep_for(chrono::milliseconds(100));
+		});
+    JSNSockTCP	peer = server.accept(error);
+    late.join();
+    CHECK(peer.valid() && !error);
+
+    /* the throwing form waits the same way */
+    thread	later([port]()
+		{
+		    this_thread::sleep_for(chrono::milliseconds(100));
+		    JSNSockTCP	client("127.0.0.1", port);
+		});
+    CHECK(server.accept().valid());
+    later.join();
+
+    /* nobody comes: ETIMEDOUT once the timeout has passed, not before */
+    server.setTimeout(0.1);
+    testClock::time_point	started = testClock::now();
+    JSNSockTCP			none = server.accept(error);
+    CHECK(!none.valid() && error.value() == ETIMEDOUT);
+    CHECK(testClock::now() - started >= chrono::milliseconds(100));
+    CHECK_THROWS(server.accept(), ETIMEDOUT);
+}
+
+static auto transfers (uint16_t port)					-> void
+{
+    loopback	link(port);
+    error_code	error;
+    char	buffer[64];
+    size_t	sent;
+    size_t	received;
+    size_t	before;
+
+    /* the first exchange may size buffers; later ones allocate nothing */
+    link.client.send("warm", 4, error);
+    link.peer.recv(buffer, sizeof(buffer), error);
+
+    before = allocations;
+    for (int i = 0; i < 100; i++)
+    {
+	sent = link.client.send("hello", 5, error);
+	received = link.peer.recv(buffer, sizeof(buffer), error);
+    }
+    CHECK(allocations == before);
+    CHECK(sent == 5 && received == 5 && !error);
+
+    /* untimed and non-blocking: EAGAIN at once */
+    link.peer.setBlocking(false);
+    before = allocations;
+    received = link.peer.recv(buffer, sizeof(buffer), error);
+    CHECK(allocations == before);
+    CHECK(received == 0 && error.value() == EAGAIN);
+
+    /* timed: ETIMEDOUT once the deadline passes */
+    link.peer.setTimeout(0.05);
+    received = link.peer.recv(buffer, sizeof(buffer), error);
+    CHECK(received == 0 && error.value() == ETIMEDOUT);
+
+    /* assigning over a socket sends what operator<< left buffered */
+    link.client << "buffered";
+    link.client = JSNSockTCP();
+    received = link.peer.recv(buffer, sizeof(buffer), error);
+    CHECK(received == 8 && string(buffer, received) == "buffered");
+
+    /* end-of-stream is zero bytes and no error */
+    link.client.close();
+    received = link.peer.recv(buffer, sizeof(buffer), error);
+    CHECK(received == 0 && !error);
+}
+
+static auto refusedAndReset (uint16_t port)				-> void
+{
+    /* nothing listens on 'port' */
+    {
+	JSNSockTCP	client;
+	error_code	error;
+
+	client.connect("127.0.0.1", port, error);
+	CHECK(error.value() == ECONNREFUSED);
+    }
+
+    /* a peer that resets: the send fails, and no signal is raised */
+    {
+	loopback	link(port + 1);
+	error_code	error;
+	struct linger	abort = { 1, 0 };
+	char		block[4096] = { 0 };
+
+	link.peer.setSockOption(SOL_SOCKET, SO_LINGER, &abort, sizeof(abort));
+	link.peer.close();	/* sends RST */
+
+	for (int i = 0; i < 100 && !error; i++)
+	    link.client.send(block, sizeof(block), error);
+	CHECK(error.value() == ECONNRESET || error.value() == EPIPE);
+    }
+}
+
+static auto exceptions ()						-> void
+{
+    errno = EMSGSIZE;
+    JSNException	original("JSNSockTest: raised.");
+    JSNException	copy(original);
+
+    CHECK(original.code() == EMSGSIZE);
+    CHECK(copy.code() == EMSGSIZE);
+    CHECK(string(copy.what()) == original.what());	/* the message lives in the object */
+    CHECK(string(original.what()).find("JSNSockTest: raised.") == 0);
+}
+
+int main ()
+{
+    accepts(basePort);
+    timedAccepts(basePort + 1);
+    transfers(basePort + 2);
+    refusedAndReset(basePort + 3);
+    exceptions();
+
+    return summary("errors");
+}
@@ -0,0 +1,202 @@
+/**
+ * jsnSock loopback tests: JSNSockFramedChannel
+ *
+ * Frames sent through one channel come back whole through another, in
+ * either prefix format and through both 'next' and 'receive'; malformed,
+ * oversized and truncated input is rejected with the documented errno.
+ *
+ * (C) 2012 Jason Browning
+ */
+
+#include <sys/socket.h>
+#include <string>
+#include <vector>
+#include <JSNSockFrame.hpp>
+#include "jsnsock_test.hpp"
+
+using namespace std;
+using namespace jsnSock;
+using namespace jsnSockTest;
+
+static const uint16_t	basePort = 47300;
+
+/* 'bytes' written as they are, then end-of-stream */
+static auto inject (loopback &link, const string &bytes)		-> void
+{
+    ::send(link.client.descriptor(), bytes.data(), bytes.size(), MSG_NOSIGNAL);
+    link.client.close();
+}
+
+static auto payload (size_t size)					-> string
+{
+    string	data(size, '\0');
+
+    for (size_t i = 0; i < size; i++)
+	data[i] = char(i * 7 + size);
+    return data;
+}
+
+/* Sizes around each prefix-length boundary, sent and read with 'next' */
+static auto roundTrip (uint16_t port, uint32_t format)			-> void
+{
+    static const size_t	sizes[] = { 0, 1, 127, 128, 255, 256, 16383, 16384, 65535, 65536, 100000 };
+    loopback		link(port);
+    JSNSockFramedChannel	sender(link.client, format);
+    JSNSockFramedChannel	receiver(link.peer, format);
+    JSNSockView		frame;
+
+    for (size_t size : sizes)
+    {
+	string	sent = payload(size);
+
+	sender.send(sent);
+	CHECK(receiver.next(frame));
+	CHECK(string(frame.data, frame.size) == sent);
+    }
+
+    link.client.close();
+    CHECK(!receiver.next(frame));	/* clean end-of-stream between frames */
+}
+
+/* Many small frames in few reads: 'receive' hands back whole batches */
+static auto batches (uint16_t port, uint32_t format)			-> void
+{
+    loopback			link(port);
+    JSNSockFramedChannel	sender(link.client, format);
+    JSNSockFramedChannel	receiver(link.peer, format);
+    vector<JSNSockView>		frames;
+    size_t			total = 0;
+    size_t			calls = 0;
+    bool			intact = true;
+
+    for (size_t i = 0; i < 500; i++)
+	sender.send(payload(i % 200));
+    link.client.close();
+
+    while (size_t n = receiver.receive(frames))
+    {
+	CHECK(n == frames.size());
+	for (const JSNSockView &frame : frames)
+	{
+	    intact = intact && string(frame.data, frame.size) == payload(total % 200);
+	    total++;
+	}
+	calls++;
+    }
+
+    CHECK(total == 500);
+    CHECK(intact);
+    CHECK(calls < total);	/* batched, not one frame per call */
+}
+
+/* The bytes of a varint prefix, unterminated after 'length' bytes */
+static auto continuing (size_t length, unsigned char last)		-> string
+{
+    return string(length, '\x80') + char(last);
+}
+
+static auto malformed (uint16_t port)					-> void
+{
+    JSNSockView		frame;
+
+    /* the tenth byte still continues: no 64-bit length is that long */
+    {
+	loopback		link(port++);
+	JSNSockFramedChannel	receiver(link.peer, JSNSockFramedChannel::varint);
+
+	inject(link, continuing(9, 0x80) + "payload");
+	CHECK_THROWS(receiver.next(frame), EPROTO);
+    }
+
+    /* the tenth byte ends the prefix but holds bits above bit 63 */
+    for (unsigned char last : { 0x02, 0x40, 0x7f })
+    {
+	loopback		link(port++);
+	JSNSockFramedChannel	receiver(link.peer, JSNSockFramedChannel::varint);
+
+	inject(link, continuing(9, last));
+	CHECK_THROWS(receiver.next(frame), EPROTO);
+    }
+
+    /* the same through 'receive' */
+    {
+	loopback		link(port++);
+	JSNSockFramedChannel	receiver(link.peer, JSNSockFramedChannel::varint);
+	vector<JSNSockView>	frames;
+
+	inject(link, continuing(9, 0x02));
+	CHECK_THROWS(receiver.receive(frames), EPROTO);
+    }
+
+    /* a tenth byte of one is bit 63 itself: well formed, but oversized */
+    {
+	loopback		link(port++);
+	JSNSockFramedChannel	receiver(link.peer, JSNSockFramedChannel::varint);
+
+	inject(link, continuing(9, 0x01));
+	CHECK_THROWS(receiver.next(frame), EMSGSIZE);
+    }
+}
+
+static auto oversized (uint16_t port)					-> void
+{
+    JSNSockView		frame;
+
+    /* a declared length over 'maxFrame' fails before its body arrives */
+    for (uint32_t format : { JSNSockFramedChannel::fixed32, JSNSockFramedChannel::varint })
+    {
+	loopback		link(port++);
+	JSNSockFramedChannel	sender(link.client, format);
+	JSNSockFramedChannel	receiver(link.peer, format, 16);
+
+	sender.send(payload(16));
+	sender.send(payload(17));
+	CHECK(receiver.next(frame) && frame.size == 16);
+	CHECK_THROWS(receiver.next(frame), EMSGSIZE);
+    }
+
+    /* and the sender refuses to write one */
+    {
+	loopback		link(port++);
+	JSNSockFramedChannel	sender(link.client, JSNSockFramedChannel::fixed32, 16);
+
+	CHECK_THROWS(sender.send(payload(17)), EMSGSIZE);
+    }
+}
+
+static auto truncated (uint16_t port)					-> void
+{
+    JSNSockView		frame;
+
+    /* end-of-stream inside a fixed32 prefix, then inside a body */
+    for (const string &bytes : { string("\0\0", 2), string("\0\0\0\x08" "abc", 7) })
+    {
+	loopback		link(port++);
+	JSNSockFramedChannel	receiver(link.peer, JSNSockFramedChannel::fixed32);
+
+	inject(link, bytes);
+	CHECK_THROWS(receiver.next(frame), EPROTO);
+    }
+
+    /* and inside a varint prefix */
+    {
+	loopback		link(port++);
+	JSNSockFramedChannel	receiver(link.peer, JSNSockFramedChannel::varint);
+
+	inject(link, continuing(2, 0x80));
+	CHECK_THROWS(receiver.next(frame), EPROTO);
+    }
+}
+
+int main ()
+{
+    roundTrip(basePort, JSNSockFramedChannel::fixed32);
+    roundTrip(basePort + 1, JSNSockFramedChannel::varint);
+    batches(basePort + 2, JSNSockFramedChannel::fixed32);
+    batches(basePort + 3, JSNSockFramedChannel::varint);
+    malformed(basePort + 10);
+    oversized(basePort + 20);
+    truncated(basePort + 30);
+
+    return summary("frame");
+}
@@ -0,0 +1,79 @@
+/**
+ * jsnSock loopback tests: shared checks
+ *
+ * Each test program includes this header, runs its cases, and returns
+ * 'summary()' from main: zero when every CHECK held.  A failed check is
+ * reported on stderr with its file and line and the run goes on.
+ *
+ * (C) 2012 Jason Browning
+ */
+
+#ifndef _jsnsock_test_HPP_
+#define _jsnsock_test_HPP_
+
+#include <iostream>
+#include <string>
+#include <JSNSock.hpp>
+
+namespace jsnSockTest
+{
+    static int	checks = 0;
+    static int	failures = 0;
+
+    inline auto fail (const char *file, int line, const std::string &what)	-> void
+    {
+	failures++;
+	std::cerr << file << ':' << line << ": " << what << std::endl;
+    }
+
+    /* A client connected to a server-side peer over 127.0.0.1 */
+    struct loopback
+    {
+	jsnSock::JSNSockTCPServer	server;
+	jsnSock::JSNSockTCP		client;
+	jsnSock::JSNSockTCP		peer;
+
+	loopback (uint16_t port)
+	{
+	    int		on = 1;
+
+	    server.setSockOption(SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	    server.bind(port, "127.0.0.1");
+	    server.listen();
+	    client.connect("127.0.0.1", port);
+	    peer = server.accept();
+	}
+    };
+
+    inline auto summary (const char *name)				-> int
+    {
+	std::cout << name << ": " << checks - failures << '/' << checks << " checks passed"
+		  << std::endl;
+	return failures ? 1 : 0;
+    }
+} /* namespace jsnSockTest */
+
+#define CHECK(condition)							\
+    do {									\
+	jsnSockTest::checks++;							\
+	if (!(condition))							\
+	    jsnSockTest::fail(__FILE__, __LINE__, "check failed: " #condition);	\
+    } while (0)
+
+/* 'statement' must throw a JSNException carrying errno value 'expected' */
+#define CHECK_THROWS(statement, expected)					\
+    do {									\
+	jsnSockTest::checks++;							\
+	try									\
+	{									\
+	    statement;								\
+	    jsnSockTest::fail(__FILE__, __LINE__, "no exception: " #statement);	\
+	}									\
+	catch (const jsnSock::JSNException &e)					\
+	{									\
+	    if (e.code() != (expected))						\
+		jsnSockTest::fail(__FILE__, __LINE__, std::string("wrong error: ") + e.what());	\
+	}									\
+    } while (0)
+
+#endif